@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include "../utils/Time.hpp"
+
+namespace libzrvan {
+namespace ds {
+
+/**
+ * @brief Time bases of ExpSlotList and ExpMap. The access times are stored as 32 bits
+ * timestamps of the clock and only their differences are used (TTL checks, ages), so the
+ * timestamps may wrap. The TTLs, the expireCheck times and the expireAt deadlines are in the
+ * units of the clock
+ */
+
+/**
+ * @brief Seconds (default)
+ */
+struct SecondsClock {
+  static constexpr uint32_t unitsPerSecond = 1;
+  static inline uint32_t now() { return libzrvan::utils::Time::getTime(); }
+};
+
+/**
+ * @brief Milliseconds, for sub-second TTLs (retransmit timers, burst windows). The timestamps
+ * wrap every ~49 days, so the TTLs and the ages must stay below that
+ */
+struct MillisClock {
+  static constexpr uint32_t unitsPerSecond = 1000;
+  static inline uint32_t now() { return libzrvan::utils::Time::getTimeMS(); }
+};
+
+}  // namespace ds
+}  // namespace libzrvan
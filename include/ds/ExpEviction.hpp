@@ -0,0 +1,39 @@
+#pragma once
+
+namespace libzrvan {
+namespace ds {
+
+/**
+ * @brief Eviction policies of ExpSlotList and ExpMap. Eviction only happens when a capacity is
+ * set, and it is done per list (per segment in ExpMap), under the lock that the insertion
+ * already holds
+ */
+enum class EvictionType { NONE, LRU, CLOCK };
+
+/**
+ * @brief Unbounded, objects are only removed by TTL or explicitly
+ */
+struct NoEviction {
+  static constexpr EvictionType type = EvictionType::NONE;
+};
+
+/**
+ * @brief Approximate LRU. The victim is the least recently accessed object of the list, based on
+ * the access time that is already kept for TTL. On ties the older slot wins. In ExpMap the
+ * segment acts as the sample, so there is no global list
+ */
+struct LRUEviction {
+  static constexpr EvictionType type = EvictionType::LRU;
+};
+
+/**
+ * @brief CLOCK (second chance) with one reference bit per object. New objects start without the
+ * reference bit, so objects that are seen once (scans) are evicted before the objects that are
+ * accessed again
+ */
+struct ClockEviction {
+  static constexpr EvictionType type = EvictionType::CLOCK;
+};
+
+}  // namespace ds
+}  // namespace libzrvan
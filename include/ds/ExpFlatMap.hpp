@@ -0,0 +1,452 @@
+#pragma once
+
+#include "../utils/CoreHash.hpp"
+#include "../utils/FastHash.hpp"
+#include "../utils/RWSpinLock.hpp"
+#include "../utils/Time.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <immintrin.h>
+#include <vector>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Thread-safe open-addressing hash table with the expiration capability.
+ * It has the same API as ExpMap, but the objects are stored inline in flat
+ * arrays, with their hashed key and TTL informations, so a lookup doesn't chase
+ * pointers.
+ *
+ * - The keys are spread over SEGCOUNT shards, each one is a flat table with its
+ * own lock, so the readers of different shards don't share a lock cache line and
+ * a growth only rehashes one shard
+ * - Linear probing over a control bytes array (7 bits of the hash per bucket).
+ * The control bytes are compared 16 at a time with SSE2, so most lookups read
+ * one control group and one bucket
+ * - Deletion uses backward shift, so there are no tombstones and the probe
+ * sequences stay short after many removals
+ * - A shard grows by doubling when it is 7/8 full. Use NullLock for the
+ * thread-confined tables
+ * - It is possible to have a duplicate key
+ *
+ * @tparam K key type class
+ * @tparam T
+ * @tparam SEGCOUNT shard count
+ * @tparam EXTEND_LIFE_ON_ACCESS considering the expiration time after the last
+ * access instead of an absolute value
+ * @tparam LOCK shard lock
+ */
+template <class K, class T, class HASH = utils::FastHash<K>,
+          uint32_t SEGCOUNT = 64, bool EXTEND_LIFE_ON_ACCESS = true,
+          class LOCK = libzrvan::utils::RWSpinLock<>>
+class ExpFlatMap {
+public:
+  using MatchFunc = std::function<bool(T &)>;
+
+private:
+  static_assert(SEGCOUNT > 0, "SEGCOUNT must be positive");
+  static constexpr uint32_t groupSize_ = 16;
+  static constexpr uint8_t emptyCtrl_ = 0x80;
+  static constexpr size_t minCapacity_ = 16;
+  static constexpr uint32_t expireCheckBuckets_ = 256;
+
+  struct Entry {
+    uint64_t key;
+    uint32_t accessTime;
+    uint32_t lifeTime;
+    T item;
+  };
+
+  //-------------------------------------------------------------------------------------
+  static inline uint64_t mix(uint64_t key) {
+    return utils::CoreHash::hash(key) ^ (key * 0x9e3779b97f4a7c15);
+  }
+  //-------------------------------------------------------------------------------------
+  static inline uint8_t tagOf(uint64_t mixed) { return (mixed >> 57); }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief One flat table and its lock. The members are only accessed under the
+   * lock, except count and capacity that are read relaxed by size() and
+   * getCapacity()
+   *
+   */
+  struct alignas(64) Shard {
+    LOCK lock;
+    // capacity + groupSize_ control bytes, the last group mirrors the first one
+    std::vector<uint8_t> ctrl;
+    std::vector<Entry> entries;
+    size_t mask = 0;
+    size_t checkIndex = 0;
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> capacity{0};
+
+    //-----------------------------------------------------------------------------------
+    inline size_t homeOf(uint64_t key) const { return mix(key) & mask; }
+    //-----------------------------------------------------------------------------------
+    inline void setCtrl(size_t index, uint8_t value) {
+      ctrl[index] = value;
+      if (index < groupSize_) {
+        ctrl[mask + 1 + index] = value;
+      }
+    }
+    //-----------------------------------------------------------------------------------
+    void init(size_t size) {
+      mask = size - 1;
+      ctrl.assign(size + groupSize_, emptyCtrl_);
+      entries.clear();
+      entries.resize(size);
+      count.store(0, std::memory_order_relaxed);
+      capacity.store(size, std::memory_order_relaxed);
+    }
+    //-----------------------------------------------------------------------------------
+    /**
+     * @brief Visit the buckets of the probe sequence that have the key tag,
+     * until the first empty bucket. The visit stops when func returns true
+     *
+     * @return size_t index of the bucket or SIZE_MAX
+     */
+    template <class F> inline size_t probeI(uint64_t key, F func) const {
+      uint64_t mixed = mix(key);
+      size_t pos = mixed & mask;
+      __m128i tag = _mm_set1_epi8(static_cast<char>(tagOf(mixed)));
+      __m128i empty = _mm_set1_epi8(static_cast<char>(emptyCtrl_));
+
+      for (size_t probed = 0; probed <= mask; probed += groupSize_) {
+        __m128i group =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl[pos]));
+        uint32_t emptyMask =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(group, empty));
+        uint32_t match = _mm_movemask_epi8(_mm_cmpeq_epi8(group, tag));
+
+        // only the buckets before the first empty one belong to the sequence
+        if (emptyMask) {
+          match &= (1U << __builtin_ctz(emptyMask)) - 1;
+        }
+        while (match) {
+          size_t index = (pos + __builtin_ctz(match)) & mask;
+          match &= match - 1;
+          if (entries[index].key == key && func(index)) {
+            return index;
+          }
+        }
+        if (emptyMask) {
+          break;
+        }
+        pos = (pos + groupSize_) & mask;
+      }
+      return SIZE_MAX;
+    }
+    //-----------------------------------------------------------------------------------
+    inline size_t findEmptyI(uint64_t key) const {
+      size_t pos = homeOf(key);
+      __m128i empty = _mm_set1_epi8(static_cast<char>(emptyCtrl_));
+      while (true) {
+        __m128i group =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl[pos]));
+        if (uint32_t emptyMask =
+                _mm_movemask_epi8(_mm_cmpeq_epi8(group, empty))) {
+          return (pos + __builtin_ctz(emptyMask)) & mask;
+        }
+        pos = (pos + groupSize_) & mask;
+      }
+    }
+    //-----------------------------------------------------------------------------------
+    inline void insertI(uint64_t key, const T &value, uint32_t expTime,
+                        uint32_t accessTime) {
+      size_t index = findEmptyI(key);
+      Entry &entry = entries[index];
+      entry.key = key;
+      entry.item = value;
+      entry.lifeTime = expTime;
+      entry.accessTime = accessTime;
+      setCtrl(index, tagOf(mix(key)));
+      count.store(count.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    }
+    //-----------------------------------------------------------------------------------
+    void growI() {
+      std::vector<Entry> oldEntries;
+      std::vector<uint8_t> oldCtrl;
+      oldEntries.swap(entries);
+      oldCtrl.swap(ctrl);
+      size_t oldSize = mask + 1;
+      init(oldSize * 2);
+      for (size_t i = 0; i < oldSize; i++) {
+        if (oldCtrl[i] != emptyCtrl_) {
+          insertI(oldEntries[i].key, oldEntries[i].item,
+                  oldEntries[i].lifeTime, oldEntries[i].accessTime);
+        }
+      }
+    }
+    //-----------------------------------------------------------------------------------
+    /**
+     * @brief Remove the bucket and shift the following buckets of the cluster
+     * back, so the probe sequences stay without holes
+     *
+     */
+    void eraseI(size_t index) {
+      size_t next = index;
+      while (true) {
+        next = (next + 1) & mask;
+        if (ctrl[next] == emptyCtrl_) {
+          break;
+        }
+        // the bucket can move back if the hole is not before its home
+        size_t home = homeOf(entries[next].key);
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+          entries[index] = std::move(entries[next]);
+          setCtrl(index, ctrl[next]);
+          index = next;
+        }
+      }
+      setCtrl(index, emptyCtrl_);
+      count.store(count.load(std::memory_order_relaxed) - 1,
+                  std::memory_order_relaxed);
+    }
+    //-----------------------------------------------------------------------------------
+    inline bool findI(uint64_t key, MatchFunc &func) {
+      return probeI(key, [&](size_t index) {
+               Entry &entry = entries[index];
+               if (func && !func(entry.item)) {
+                 return false;
+               }
+               if (EXTEND_LIFE_ON_ACCESS) {
+                 entry.accessTime = libzrvan::utils::Time::getTime();
+               }
+               return true;
+             }) != SIZE_MAX;
+    }
+  };
+
+  Shard shards_[SEGCOUNT];
+  // next shard of expireCheck
+  std::atomic<uint32_t> expireShard_{0};
+  HASH hash_;
+
+  //-------------------------------------------------------------------------------------
+  // the shard uses the high half of the mixed hash, the probing uses the low bits
+  inline Shard &getShard(uint64_t key) {
+    return shards_[(mix(key) >> 32) % SEGCOUNT];
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Exp Flat Map object
+   *
+   * @param capacity initial capacity (buckets), split over the shards
+   */
+  explicit ExpFlatMap(size_t capacity = 1024) {
+    // warm the timer !
+    libzrvan::utils::Time().getTime();
+    size_t size = minCapacity_;
+    while (size * SEGCOUNT < capacity) {
+      size <<= 1;
+    }
+    for (auto &shard : shards_) {
+      shard.init(size);
+    }
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Disable copy and move constructor
+   *
+   */
+  ExpFlatMap(const ExpFlatMap &) = delete;
+  ExpFlatMap(ExpFlatMap &&obj) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true
+   * @return false
+   */
+  bool add(const K &key, const T &value, uint32_t expTime) {
+    uint64_t keyval = hash_(key);
+    Shard &shard = getShard(keyval);
+    shard.lock.lock();
+    if ((shard.count.load(std::memory_order_relaxed) + 1) * 8 >
+        (shard.mask + 1) * 7) {
+      shard.growI();
+    }
+    shard.insertI(keyval, value, expTime, libzrvan::utils::Time::getTime());
+    shard.lock.unlock();
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool remove(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Shard &shard = getShard(keyval);
+    shard.lock.lock();
+    size_t index = shard.probeI(keyval, [&](size_t index) {
+      return (!func || func(shard.entries[index].item));
+    });
+    if (index != SIZE_MAX) {
+      shard.eraseI(index);
+    }
+    shard.lock.unlock();
+    return (index != SIZE_MAX);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Use this function to access the object in the read-only mode
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool findR(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Shard &shard = getShard(keyval);
+    shard.lock.lock_shared();
+    bool res = shard.findI(keyval, func);
+    shard.lock.unlock_shared();
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Use this function to access the object in the read-write mode
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool findW(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Shard &shard = getShard(keyval);
+    shard.lock.lock();
+    bool res = shard.findI(keyval, func);
+    shard.lock.unlock();
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Check the next range of buckets for the expired items. Each call
+   * checks one shard, the shards are visited in turn
+   *
+   * @param cTime
+   * @param func
+   * @return size_t
+   */
+  size_t expireCheck(uint32_t cTime, MatchFunc func = nullptr) {
+    size_t cnt = 0;
+    Shard &shard =
+        shards_[expireShard_.fetch_add(1, std::memory_order_relaxed) %
+                SEGCOUNT];
+
+    // expire check is a low priority functionality.
+    if (!shard.lock.try_lock()) {
+      return 0;
+    }
+
+    if (!cTime) {
+      cTime = libzrvan::utils::Time::getTime();
+    }
+
+    size_t index = shard.checkIndex & shard.mask;
+    for (uint32_t i = 0; i < expireCheckBuckets_ && i <= shard.mask; i++) {
+      // backward shift may move another item to this bucket, check it again
+      while (shard.ctrl[index] != emptyCtrl_) {
+        Entry &entry = shard.entries[index];
+        if (cTime - entry.accessTime <= entry.lifeTime ||
+            (func && !func(entry.item))) {
+          break;
+        }
+        shard.eraseI(index);
+        cnt++;
+      }
+      index = (index + 1) & shard.mask;
+    }
+    shard.checkIndex = index;
+    shard.lock.unlock();
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Visit the shards in turn, only one shard is locked at a time
+   *
+   * @param func
+   * @return size_t
+   */
+  size_t forEach(MatchFunc func = nullptr) {
+    size_t cnt = 0;
+    for (auto &shard : shards_) {
+      shard.lock.lock_shared();
+      for (size_t i = 0; i <= shard.mask; i++) {
+        if (shard.ctrl[i] != emptyCtrl_) {
+          if (func) {
+            func(shard.entries[i].item);
+          }
+          cnt++;
+        }
+      }
+      shard.lock.unlock_shared();
+    }
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Flush all the items and clean it
+   *
+   * @param func
+   */
+  void flush(MatchFunc func = nullptr) {
+    for (auto &shard : shards_) {
+      shard.lock.lock();
+      for (size_t i = 0; i <= shard.mask; i++) {
+        if (shard.ctrl[i] != emptyCtrl_ && func) {
+          func(shard.entries[i].item);
+        }
+      }
+      shard.init(shard.mask + 1);
+      shard.lock.unlock();
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the buckets count of all the shards
+   *
+   * @return size_t
+   */
+  size_t getCapacity() const {
+    size_t res = 0;
+    for (auto &shard : shards_) {
+      res += shard.capacity.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get availabe items count
+   *
+   * @return size_t
+   */
+  size_t size() const {
+    size_t res = 0;
+    for (auto &shard : shards_) {
+      res += shard.count.load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+};
+} // namespace ds
+} // namespace libzrvan
@@ -2,13 +2,68 @@
 
 #include "../utils/CoreHash.hpp"
 #include "../utils/FastHash.hpp"
+#include "../utils/HugePage.hpp"
+#include "../utils/NullLock.hpp"
+#include "../utils/Numa.hpp"
+#include "../utils/StripedCounter.hpp"
+#include "../utils/ThreadPool.hpp"
 #include "../utils/Time.hpp"
+#include "ExpClock.hpp"
+#include "ExpEviction.hpp"
+#include "ExpMapChangeFeed.hpp"
+#include "ExpMapStats.hpp"
 #include "ExpSlotList.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace libzrvan {
 namespace ds {
 
+//---------------------------------------------------------------------------------------
+/**
+ * @brief ExpMap construction options
+ *
+ */
+struct ExpMapOptions {
+  // spread the segments over the NUMA nodes and allocate the slots of each
+  // segment on the node of the segment
+  bool numaAware = false;
+  // back the segments array and the slots with 2MB pages
+  bool hugePages = false;
+  // allocate the segments array, the slots and the allocator-aware values
+  // from this resource. numaAware and hugePages are ignored if it is set
+  std::pmr::memory_resource *resource = nullptr;
+  // capacity bound (0 means unbounded), only used with an EVICTION policy. The
+  // bound is split equally between the segments and each segment evicts its
+  // own objects, so with uneven hashing the eviction starts before the total
+  // is reached (twoChoice reduces it). The bound must not be smaller than
+  // SEGCOUNT (std::invalid_argument). maxBytes bounds the segments array, the
+  // Bloom filters and the slots, it is converted to whole slots per segment
+  // and must leave at least one slot per segment
+  size_t maxItems = 0;
+  size_t maxBytes = 0;
+  // power of two choices. Each key has two candidate segments, new objects go
+  // to the less loaded one and lookups check both
+  bool twoChoice = false;
+  // Bloom filter cache lines per segment (0 disables). Lookups check the
+  // filter of the segment before taking its lock, so most misses don't lock.
+  // It is rounded up to a power of two
+  uint32_t bloomBlocks = 0;
+};
 //---------------------------------------------------------------------------------------
 /**
  * @brief Thread-safe hash linked list data structure with the expiration
@@ -22,24 +77,374 @@ namespace ds {
  * access instead of an absolute value
  * @tparam PRELOAD Preloading the hash segments. It will increase the insertion
  * speed in the cost of higher memory usage
+ * @tparam LOCK segments lock
+ * @tparam EVICTION eviction policy used when a capacity is set (see
+ * ExpEviction.hpp)
+ * @tparam STATS statistics policy, NoStats or ExpMapStats (see
+ * ExpMapStats.hpp)
+ * @tparam CLOCK time base of the TTLs, SecondsClock or MillisClock (see
+ * ExpClock.hpp)
  */
 template <class K, class T, class HASH = utils::FastHash<K>,
           uint32_t SEGCOUNT = 256000, bool EXTEND_LIFE_ON_ACCESS = true,
           bool PRELOAD = true,
-          class LOCK=libzrvan::utils::RWSpinLock<>>
+          class LOCK=libzrvan::utils::RWSpinLock<>,
+          class EVICTION = NoEviction, class STATS = NoStats,
+          class CLOCK = SecondsClock>
 class ExpMap {
 public:
+  using KeyType = K;
+  using ValueType = T;
   using MatchFunc = std::function<bool(T &)>;
+  using BatchMatchFunc = std::function<bool(size_t index, T &)>;
+  using FactoryFunc = std::function<T()>;
+  using ComputeFunc = std::function<bool(T &, bool exists)>;
+  using ComputeResult = typename ExpSlotList<T, EXTEND_LIFE_ON_ACCESS, LOCK,
+                                             EVICTION, CLOCK>::ComputeResult;
+  using ChangeFeed = ExpMapChangeFeed<T>;
+  using Change = ExpChange<T>;
+
+  /**
+   * @brief Pre-hashed insert request, see addGroup
+   *
+   */
+  struct InsertItem {
+    uint64_t key;
+    uint32_t segment;
+    uint32_t expTime;
+    T object;
+  };
 
 private:
+  using SlotList =
+      ExpSlotList<T, EXTEND_LIFE_ON_ACCESS, LOCK, EVICTION, CLOCK>;
+
   // hash segments
-  ExpSlotList<T, EXTEND_LIFE_ON_ACCESS,LOCK> *segmensts_;
-  uint32_t checkIndex_ = 0;
-  std::atomic<size_t> count_ = 0;
+  SlotList *segmensts_;
+  // objects count, per-thread stripes. A thread-confined map (NullLock) uses a
+  // single writer counter, so its updates are plain memory accesses
+  using CountType =
+      std::conditional_t<std::is_same_v<LOCK, libzrvan::utils::NullLock>,
+                         utils::PlainCounter, utils::StripedCounter<>>;
+  CountType count_;
+  // per-thread expire cursors, each one starts from a different range
+  struct alignas(64) ExpireCursor {
+    std::atomic<uint32_t> index = {0};
+  };
+  static constexpr uint32_t expireCursorsCount_ = 64;
+  ExpireCursor expireCursors_[expireCursorsCount_];
   HASH hash_;
+  static constexpr uint32_t batchGroupSize_ = 32;
+
+  // user memory resource
+  std::pmr::memory_resource *resource_ = nullptr;
+
+  // eviction, per segment capacity and slots (0 means unbounded)
+  size_t segmentCapacity_ = 0;
+  size_t segmentSlots_ = 0;
+
+  // power of two choices, the read-modify-write operations of one key are
+  // serialized by a key stripe lock
+  struct alignas(64) UpdateLock {
+    LOCK lock;
+  };
+  static constexpr uint32_t updateLocksCount_ = 1024;
+  bool twoChoice_ = false;
+  std::unique_ptr<UpdateLock[]> updateLocks_;
+
+  // per segment Bloom filters
+  std::unique_ptr<typename SlotList::BloomBlock[]> bloom_;
+
+  // change feed
+  typename SlotList::ChangeFunction changeFunc_;
+
+  // statistics
+  STATS stats_;
+  static constexpr uint32_t hotSegmentsCount_ = 8;
+
+  // snapshot file format
+  static constexpr char snapshotMagic_[8] = {'Z', 'R', 'V', 'N',
+                                             'E', 'X', 'P', 'M'};
+  // version 2: integral keys are mixed by FastHash
+  // version 3: the clock units are recorded
+  static constexpr uint32_t snapshotVersion_ = 3;
+
+  struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t segments;
+    uint32_t valueSize;
+    // CLOCK::unitsPerSecond, the lifetimes and the ages are in clock units
+    uint32_t clockUnits;
+    uint64_t count;
+  };
+
+  struct SnapshotSegment {
+    uint32_t segment;
+    uint32_t entries;
+  };
+
+  // entry: key (8), lifetime (4), age (4), value
+  static constexpr size_t snapshotEntrySize_ = 16 + sizeof(T);
+
+  // NUMA and huge page placement
+  bool pageSegments_ = false;
+  bool numa_ = false;
+  bool hugePages_ = false;
+  uint32_t nodesCount_ = 1;
+  size_t segmentsBytes_ = 0;
+  std::vector<std::unique_ptr<utils::NumaMemoryResource>> nodeUpstreams_;
+  std::vector<std::unique_ptr<std::pmr::synchronized_pool_resource>>
+      nodePools_;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief The segments array is split into equal page ranges, one range per
+   * node
+   *
+   */
+  inline uint32_t getPageNode(size_t page) const {
+    return (page * nodesCount_) / (segmentsBytes_ / utils::Numa::pageSize());
+  }
+  //-------------------------------------------------------------------------------------
+  inline uint32_t getSegmentNode(uint32_t segment) const {
+    if (!numa_) {
+      return 0;
+    }
+    return getPageNode((segment * sizeof(SlotList)) / utils::Numa::pageSize());
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Allocate the segments array from page mappings. In NUMA mode each
+   * page range is bound to its node before the first touch and the slots of
+   * each segment are allocated from a pool on the same node. In huge page mode
+   * the array and the slot pools are backed by 2MB pages
+   *
+   */
+  static uint32_t getBloomBlocks(const ExpMapOptions &options) {
+    uint32_t blocks = 0;
+    if (options.bloomBlocks) {
+      blocks = 1;
+      while (blocks < options.bloomBlocks) {
+        blocks <<= 1;
+      }
+    }
+    return blocks;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Split the capacity bound between the segments. Each segment gets an
+   * equal share, rounded down. The bytes bound is converted to whole slots per
+   * segment, after the fixed cost (the segments array and the Bloom filters)
+   */
+  void setCapacityI(const ExpMapOptions &options) {
+    if constexpr (EVICTION::type != EvictionType::NONE) {
+      size_t capacity = options.maxItems;
+      if (options.maxBytes) {
+        size_t fixed = sizeof(SlotList) * SEGCOUNT +
+                       size_t(SEGCOUNT) * getBloomBlocks(options) *
+                           sizeof(typename SlotList::BloomBlock);
+        size_t bytes = options.maxBytes > fixed ? options.maxBytes - fixed : 0;
+        segmentSlots_ = bytes / SEGCOUNT / SlotList::getSlotSize();
+        if (!segmentSlots_) {
+          throw std::invalid_argument(
+              "ExpMap maxBytes is smaller than one slot per segment");
+        }
+        size_t slotsCapacity = segmentSlots_ * 64 * SEGCOUNT;
+        capacity = capacity ? std::min(capacity, slotsCapacity) : slotsCapacity;
+      }
+      if (capacity) {
+        if (capacity < SEGCOUNT) {
+          throw std::invalid_argument(
+              "ExpMap capacity is smaller than the segments count");
+        }
+        segmentCapacity_ = capacity / SEGCOUNT;
+      }
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  void createPageSegments(const ExpMapOptions &options) {
+    pageSegments_ = true;
+    numa_ = options.numaAware;
+    hugePages_ = options.hugePages;
+    nodesCount_ = numa_ ? utils::Numa::nodesCount() : 1;
+    segmentsBytes_ =
+        utils::HugePage::roundUp(sizeof(SlotList) * SEGCOUNT, hugePages_);
+
+    void *mem = utils::HugePage::map(segmentsBytes_, hugePages_);
+    if (!mem) {
+      throw std::bad_alloc();
+    }
+
+    // bind the page ranges
+    size_t page = utils::Numa::pageSize();
+    size_t pages = segmentsBytes_ / page;
+    size_t begin = 0;
+    while (numa_ && begin < pages) {
+      size_t end = begin + 1;
+      while (end < pages && getPageNode(end) == getPageNode(begin)) {
+        end++;
+      }
+      utils::Numa::bind(static_cast<uint8_t *>(mem) + begin * page,
+                        (end - begin) * page, getPageNode(begin));
+      begin = end;
+    }
+
+    // per node slot pools
+    std::pmr::pool_options opt;
+    opt.largest_required_pool_block = SlotList::getSlotSize();
+    for (uint32_t i = 0; i < nodesCount_; i++) {
+      nodeUpstreams_.emplace_back(std::make_unique<utils::NumaMemoryResource>(
+          numa_ ? i : utils::NumaMemoryResource::anyNode, hugePages_));
+      nodePools_.emplace_back(
+          std::make_unique<std::pmr::synchronized_pool_resource>(
+              opt, nodeUpstreams_.back().get()));
+    }
+
+    // first touch
+    segmensts_ = static_cast<SlotList *>(mem);
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      new (&segmensts_[i]) SlotList();
+      segmensts_[i].setMemoryResource(nodePools_[getSegmentNode(i)].get());
+    }
+  }
 
   //-------------------------------------------------------------------------------------
   inline uint32_t getSegment(uint64_t key) const { return (key % SEGCOUNT); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Second candidate segment (two choice mode). It is derived from the
+   * other half of the hash bits, so it is independent of the first one
+   *
+   */
+  inline uint32_t getAltSegment(uint64_t key) const {
+    return utils::CoreHash::hash((key >> 32) | (key << 32)) % SEGCOUNT;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Segment of a new object, the less loaded candidate in two choice
+   * mode
+   *
+   */
+  inline uint32_t getInsertSegment(uint64_t key) {
+    uint32_t seg = getSegment(key);
+    if (twoChoice_) {
+      uint32_t alt = getAltSegment(key);
+      if (segmensts_[alt].size() < segmensts_[seg].size()) {
+        seg = alt;
+      }
+    }
+    return seg;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run a read-modify-write operation on the segment of the key. In two
+   * choice mode it is the candidate that holds the key (checked without side
+   * effects), or the less loaded one for the new keys. The operations of one
+   * key are serialized by a key stripe lock, so concurrent inserts of a new key
+   * can't end up in both candidates
+   *
+   */
+  template <class F> inline auto updateI(uint64_t key, F func) {
+    if (!twoChoice_) {
+      return func(segmensts_[getSegment(key)]);
+    }
+    auto &lock = updateLocks_[utils::CoreHash::hash(key) % updateLocksCount_];
+    lock.lock.lock();
+    uint32_t seg = getSegment(key);
+    uint32_t alt = getAltSegment(key);
+    if (alt != seg && !segmensts_[seg].contains(key)) {
+      seg = segmensts_[alt].contains(key) ? alt : getInsertSegment(key);
+    }
+    auto res = func(segmensts_[seg]);
+    lock.lock.unlock();
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run func on the first candidate segment and, in two choice mode, on
+   * the second one if func returned false. Both segments are prefetched first
+   *
+   */
+  template <class F> inline bool bothSegmentsI(uint64_t key, F func) {
+    uint32_t seg = getSegment(key);
+    if (!twoChoice_) {
+      return func(segmensts_[seg]);
+    }
+    uint32_t alt = getAltSegment(key);
+    __builtin_prefetch(&segmensts_[seg]);
+    __builtin_prefetch(&segmensts_[alt]);
+    segmensts_[seg].prefetch();
+    segmensts_[alt].prefetch();
+    return func(segmensts_[seg]) || (alt != seg && func(segmensts_[alt]));
+  }
+  //-------------------------------------------------------------------------------------
+  inline size_t expireSegmentI(SlotList &segment, uint32_t cTime,
+                               MatchFunc &func) {
+    if constexpr (STATS::enabled) {
+      typename SlotList::ExpireInfo info;
+      size_t cnt = segment.expireCheck(cTime, func, &info);
+      stats_.onExpireCheck(info.lockLost, cnt, info.maxLag);
+      return cnt;
+    }
+    return segment.expireCheck(cTime, func);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Account the objects that the segment evicted to make room for the
+   * insertions
+   *
+   */
+  inline void evictedI(SlotList &segment) {
+    if constexpr (EVICTION::type != EvictionType::NONE) {
+      count_ -= segment.takeEvicted();
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run func for each key, in groups of batchGroupSize_. For each group
+   * all the keys are hashed first, then the segments and the head slots are
+   * prefetched in separate stages and finally the segments are probed
+   *
+   * @param keys
+   * @param count
+   * @param func called with (key index, segment, hashed key)
+   * @return size_t number of the func calls that returned true
+   */
+  template <class F>
+  inline size_t batchI(const K *keys, size_t count, F func) {
+    uint64_t keyvals[batchGroupSize_];
+    uint32_t segs[batchGroupSize_];
+    size_t total = 0;
+
+    for (size_t base = 0; base < count; base += batchGroupSize_) {
+      size_t n = std::min<size_t>(batchGroupSize_, count - base);
+
+      // hash
+      for (size_t i = 0; i < n; i++) {
+        keyvals[i] = hash_(keys[base + i]);
+        segs[i] = getSegment(keyvals[i]);
+      }
+
+      // prefetch segments (lock and root)
+      for (size_t i = 0; i < n; i++) {
+        __builtin_prefetch(&segmensts_[segs[i]], 1);
+      }
+
+      // prefetch head slots
+      for (size_t i = 0; i < n; i++) {
+        segmensts_[segs[i]].prefetch();
+      }
+
+      // probe
+      for (size_t i = 0; i < n; i++) {
+        if (func(base + i, segs[i], keyvals[i])) {
+          total++;
+        }
+      }
+    }
+    return total;
+  }
 
 public:
   //-------------------------------------------------------------------------------------
@@ -47,12 +452,49 @@ public:
    * @brief Construct a new Exp Map objects
    *
    */
-  ExpMap() {
+  ExpMap(const ExpMapOptions &options = ExpMapOptions()) {
     // warm the timer !
     libzrvan::utils::Time().getTime();
+    twoChoice_ = options.twoChoice;
+    if (twoChoice_) {
+      updateLocks_.reset(new UpdateLock[updateLocksCount_]);
+    }
+    setCapacityI(options);
+
+    for (uint32_t i = 0; i < expireCursorsCount_; i++) {
+      expireCursors_[i].index =
+          (uint64_t(SEGCOUNT) * i / expireCursorsCount_) % SEGCOUNT;
+    }
 
     // create segments lits
-    segmensts_ = new ExpSlotList<T, EXTEND_LIFE_ON_ACCESS>[SEGCOUNT];
+    if (options.resource) {
+      resource_ = options.resource;
+      segmensts_ = static_cast<SlotList *>(resource_->allocate(
+          sizeof(SlotList) * SEGCOUNT, alignof(SlotList)));
+      for (uint32_t i = 0; i < SEGCOUNT; i++) {
+        new (&segmensts_[i]) SlotList(resource_);
+      }
+    } else if (options.numaAware || options.hugePages) {
+      createPageSegments(options);
+    } else {
+      segmensts_ = new SlotList[SEGCOUNT];
+    }
+
+    // capacity
+    if (segmentCapacity_) {
+      for (uint32_t i = 0; i < SEGCOUNT; i++) {
+        segmensts_[i].setCapacity(segmentCapacity_, segmentSlots_);
+      }
+    }
+    // Bloom filters
+    if (options.bloomBlocks) {
+      uint32_t blocks = getBloomBlocks(options);
+      bloom_.reset(
+          new typename SlotList::BloomBlock[size_t(SEGCOUNT) * blocks]());
+      for (uint32_t i = 0; i < SEGCOUNT; i++) {
+        segmensts_[i].setBloomFilter(&bloom_[size_t(i) * blocks], blocks);
+      }
+    }
     if (PRELOAD) {
       for (uint32_t i = 0; i < SEGCOUNT; i++) {
         segmensts_[i].preLoad();
@@ -73,7 +515,21 @@ public:
    * @brief Destroy the Exp Map object
    *
    */
-  ~ExpMap() { delete[] segmensts_; }
+  ~ExpMap() {
+    if (!pageSegments_ && !resource_) {
+      delete[] segmensts_;
+      return;
+    }
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      segmensts_[i].~SlotList();
+    }
+    if (resource_) {
+      resource_->deallocate(segmensts_, sizeof(SlotList) * SEGCOUNT,
+                            alignof(SlotList));
+    } else {
+      utils::HugePage::unmap(segmensts_, segmentsBytes_);
+    }
+  }
   //-------------------------------------------------------------------------------------
   /**
    * @brief
@@ -86,8 +542,10 @@ public:
    */
   bool add(const K &key, const T &value, uint32_t expTime) {
     uint64_t keyval = hash_(key);
-    if (segmensts_[getSegment(keyval)].add(keyval, value, expTime)) {
-      count_++;
+    SlotList &segment = segmensts_[getInsertSegment(keyval)];
+    if (segment.add(keyval, value, expTime)) {
+      count_ += 1;
+      evictedI(segment);
       return true;
     }
     return false;
@@ -120,13 +578,102 @@ public:
    */
   bool remove(const K &key, MatchFunc func = nullptr) {
     uint64_t keyval = hash_(key);
-    if (segmensts_[getSegment(keyval)].remove(keyval, func)) {
-      count_--;
+    if (bothSegmentsI(keyval, [&](SlotList &segment) {
+          return segment.remove(keyval, func);
+        })) {
+      count_ -= 1;
       return true;
     }
     return false;
   }
   //-------------------------------------------------------------------------------------
+  /**
+   * @brief Insert the value or replace the existing one. The segment is locked
+   * once and the chain is walked once
+   *
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true if a new item was inserted
+   * @return false if an existing item was updated
+   */
+  bool upsert(const K &key, const T &value, uint32_t expTime) {
+    uint64_t keyval = hash_(key);
+    return updateI(keyval, [&](SlotList &segment) {
+      if (segment.upsert(keyval, value, expTime)) {
+        count_ += 1;
+        evictedI(segment);
+        return true;
+      }
+      return false;
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Access the item in read-write mode, create it by the factory
+   * function if it does not exist
+   *
+   * @param key
+   * @param factory
+   * @param expTime TTL of the new item
+   * @param func
+   * @return true if a new item was inserted
+   * @return false
+   */
+  bool findOrInsert(const K &key, FactoryFunc factory, uint32_t expTime,
+                    MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    return updateI(keyval, [&](SlotList &segment) {
+      if (segment.findOrInsert(keyval, factory, expTime, func)) {
+        count_ += 1;
+        evictedI(segment);
+        return true;
+      }
+      return false;
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Insert, update or remove the item under one segment lock
+   *
+   * @param key
+   * @param func returning false removes the existing item or skips the
+   * insertion
+   * @param expTime TTL of the new item
+   * @return ComputeResult
+   */
+  ComputeResult compute(const K &key, ComputeFunc func, uint32_t expTime) {
+    uint64_t keyval = hash_(key);
+    return updateI(keyval, [&](SlotList &segment) {
+      ComputeResult res = segment.compute(keyval, func, expTime);
+      if (res == ComputeResult::INSERTED) {
+        count_ += 1;
+        evictedI(segment);
+      } else if (res == ComputeResult::REMOVED) {
+        count_ -= 1;
+      }
+      return res;
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove all the items with the key that match the predicate
+   *
+   * @param key
+   * @param pred
+   * @return size_t number of removed items
+   */
+  size_t removeIf(const K &key, MatchFunc pred = nullptr) {
+    uint64_t keyval = hash_(key);
+    size_t cnt = 0;
+    bothSegmentsI(keyval, [&](SlotList &segment) {
+      cnt += segment.removeIf(keyval, pred);
+      return false;
+    });
+    count_ -= cnt;
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
   /**
    * @brief
    *
@@ -137,7 +684,20 @@ public:
    */
   bool findR(const K &key, MatchFunc func = nullptr) {
     uint64_t keyval = hash_(key);
-    return segmensts_[getSegment(keyval)].findR(keyval, func);
+    if constexpr (STATS::enabled) {
+      uint32_t probes = 0;
+      bool res = bothSegmentsI(keyval, [&](SlotList &segment) {
+        uint32_t cnt = 0;
+        bool found = segment.findR(keyval, func, &cnt);
+        probes += cnt;
+        return found;
+      });
+      stats_.onFind(probes, res);
+      return res;
+    }
+    return bothSegmentsI(keyval, [&](SlotList &segment) {
+      return segment.findR(keyval, func);
+    });
   }
   //-------------------------------------------------------------------------------------
   /**
@@ -150,7 +710,321 @@ public:
    */
   bool findW(const K &key, MatchFunc func = nullptr) {
     uint64_t keyval = hash_(key);
-    return segmensts_[getSegment(keyval)].findW(keyval, func);
+    if constexpr (STATS::enabled) {
+      uint32_t probes = 0;
+      bool res = bothSegmentsI(keyval, [&](SlotList &segment) {
+        uint32_t cnt = 0;
+        bool found = segment.findW(keyval, func, &cnt);
+        probes += cnt;
+        return found;
+      });
+      stats_.onFind(probes, res);
+      return res;
+    }
+    return bothSegmentsI(keyval, [&](SlotList &segment) {
+      return segment.findW(keyval, func);
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Visit all the items with the key (duplicate keys) in one locked chain
+   * walk per candidate segment, in the read-only mode
+   *
+   * @param key
+   * @param func called for each item, returning false stops the visit
+   * @return size_t number of visited items
+   */
+  size_t findAll(const K &key, MatchFunc func) {
+    uint64_t keyval = hash_(key);
+    bool stopped = false;
+    uint32_t seg = getSegment(keyval);
+    size_t cnt = segmensts_[seg].findAll(keyval, func, &stopped);
+    if (twoChoice_ && !stopped) {
+      uint32_t alt = getAltSegment(keyval);
+      if (alt != seg) {
+        cnt += segmensts_[alt].findAll(keyval, func);
+      }
+    }
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the number of the items with the key
+   *
+   * @param key
+   * @return size_t
+   */
+  size_t count(const K &key) {
+    uint64_t keyval = hash_(key);
+    uint32_t seg = getSegment(keyval);
+    size_t cnt = segmensts_[seg].findAll(keyval);
+    if (twoChoice_) {
+      uint32_t alt = getAltSegment(keyval);
+      if (alt != seg) {
+        cnt += segmensts_[alt].findAll(keyval);
+      }
+    }
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Restart the TTL of the item with a new TTL value
+   *
+   * @param key
+   * @param expTime new TTL (CLOCK units)
+   * @return true
+   * @return false if the key doesn't exist
+   */
+  bool touch(const K &key, uint32_t expTime) {
+    uint64_t keyval = hash_(key);
+    return bothSegmentsI(keyval, [&](SlotList &segment) {
+      return segment.touch(keyval, expTime);
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Set an absolute expiration time for the item. If EXTEND_LIFE_ON_ACCESS
+   * is set, the next accesses extend it again by the remaining time
+   *
+   * @param key
+   * @param deadline CLOCK::now() based time, a passed deadline expires the item
+   * on the next expire check
+   * @return true
+   * @return false if the key doesn't exist
+   */
+  bool expireAt(const K &key, uint32_t deadline) {
+    int32_t remaining = static_cast<int32_t>(deadline - CLOCK::now());
+    return touch(key, remaining > 0 ? remaining : 0);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add a group of items. Segments are prefetched before insertion
+   *
+   * @param keys
+   * @param values
+   * @param count
+   * @param expTime
+   * @return size_t number of added items
+   */
+  size_t addBatch(const K *keys, const T *values, size_t count,
+                  uint32_t expTime) {
+    size_t total =
+        batchI(keys, count, [&](size_t index, uint32_t seg, uint64_t keyval) {
+          if (twoChoice_) {
+            seg = getInsertSegment(keyval);
+          }
+          bool res = segmensts_[seg].add(keyval, values[index], expTime);
+          evictedI(segmensts_[seg]);
+          return res;
+        });
+    count_ += total;
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Hash the key and build an insert request for addGroup
+   *
+   * @param key
+   * @param value
+   * @param expTime
+   * @return InsertItem
+   */
+  InsertItem makeInsertItem(const K &key, const T &value, uint32_t expTime) {
+    uint64_t keyval = hashKey(key);
+    return InsertItem{keyval, getInsertSegment(keyval), expTime, value};
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Hash value of the key, as it is stored in the segments
+   *
+   * @param key
+   * @return uint64_t
+   */
+  uint64_t hashKey(const K &key) { return hash_(key); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add a group of pre-hashed items. Items must be grouped by segment,
+   * each group is added under one segment lock
+   *
+   * @param items
+   * @param count
+   * @return size_t number of added items
+   */
+  size_t addGroup(const InsertItem *items, size_t count) {
+    size_t total = 0;
+    size_t begin = 0;
+    while (begin < count) {
+      size_t end = begin + 1;
+      while (end < count && items[end].segment == items[begin].segment) {
+        end++;
+      }
+      SlotList &segment = segmensts_[items[begin].segment];
+      total += segment.addGroup(&items[begin], end - begin);
+      evictedI(segment);
+      begin = end;
+    }
+    count_ += total;
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove a group of items. Segments are prefetched before removal
+   *
+   * @param keys
+   * @param count
+   * @param removed optional, removed[i] is set to the result of keys[i]
+   * @return size_t number of removed items
+   */
+  size_t removeBatch(const K *keys, size_t count, bool *removed = nullptr) {
+    size_t total =
+        batchI(keys, count, [&](size_t index, uint32_t seg, uint64_t keyval) {
+          bool res = segmensts_[seg].remove(keyval);
+          if (!res && twoChoice_) {
+            uint32_t alt = getAltSegment(keyval);
+            res = (alt != seg) && segmensts_[alt].remove(keyval);
+          }
+          if (removed) {
+            removed[index] = res;
+          }
+          return res;
+        });
+    count_ -= total;
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Read-only lookup of a group of keys. Segments are prefetched before
+   * the search
+   *
+   * @param keys
+   * @param count
+   * @param found optional, found[i] is set to the result of keys[i]
+   * @param func called with the index of the key and the object
+   * @return size_t number of found items
+   */
+  size_t findBatch(const K *keys, size_t count, bool *found = nullptr,
+                   BatchMatchFunc func = nullptr) {
+    return batchI(keys, count,
+                  [&](size_t index, uint32_t seg, uint64_t keyval) {
+                    bool res;
+                    auto findFunc = [&](SlotList &segment) {
+                      if (func) {
+                        return segment.findR(keyval, [&](T &obj) {
+                          return func(index, obj);
+                        });
+                      }
+                      return segment.findR(keyval);
+                    };
+                    res = findFunc(segmensts_[seg]);
+                    if (!res && twoChoice_) {
+                      uint32_t alt = getAltSegment(keyval);
+                      res = (alt != seg) && findFunc(segmensts_[alt]);
+                    }
+                    if (found) {
+                      found[index] = res;
+                    }
+                    return res;
+                  });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Read-only lookup of a group of keys with interleaved chain walks
+   * (AMAC). Up to INFLIGHT lookups are active at the same time; each one checks
+   * a single slot per step and prefetches the next slot before switching to
+   * the next lookup, so the misses of different chains overlap
+   *
+   * @tparam INFLIGHT number of interleaved lookups
+   * @param keys
+   * @param count
+   * @param found optional, found[i] is set to the result of keys[i]
+   * @param func called with the index of the key and the object
+   * @return size_t number of found items
+   */
+  template <uint32_t INFLIGHT = 16>
+  size_t findInterleaved(const K *keys, size_t count, bool *found = nullptr,
+                         BatchMatchFunc func = nullptr) {
+    struct Lookup {
+      typename SlotList::Probe probe;
+      typename SlotList::MatchFunction match;
+      SlotList *segment = nullptr;
+      uint64_t keyval = 0;
+      size_t index = 0;
+      bool started = false;
+      bool second = false;
+    };
+
+    Lookup lanes[INFLIGHT];
+    size_t next = 0;
+    size_t total = 0;
+    uint32_t active = 0;
+
+    // assign the next key to the lane and prefetch its segment
+    auto start = [&](Lookup &lane) -> bool {
+      if (next == count) {
+        lane.segment = nullptr;
+        return false;
+      }
+      lane.index = next++;
+      lane.keyval = hash_(keys[lane.index]);
+      lane.segment = &segmensts_[getSegment(lane.keyval)];
+      lane.started = false;
+      lane.second = false;
+      if (func) {
+        size_t index = lane.index;
+        lane.match = [&func, index](T &obj) { return func(index, obj); };
+      }
+      __builtin_prefetch(lane.segment, 1);
+      return true;
+    };
+
+    for (auto &lane : lanes) {
+      if (start(lane)) {
+        active++;
+      }
+    }
+
+    while (active) {
+      for (auto &lane : lanes) {
+        if (!lane.segment) {
+          continue;
+        }
+
+        if (!lane.started) {
+          if (lane.segment->mayContain(lane.keyval)) {
+            lane.started = lane.segment->beginProbe(lane.probe, lane.keyval);
+            continue;
+          }
+          // filtered out, finished without locking the segment
+          lane.probe = typename SlotList::Probe();
+        } else if (!lane.segment->stepProbe(lane.probe, lane.match)) {
+          continue;
+        }
+
+        // two choice mode, continue with the second candidate
+        if (twoChoice_ && !lane.probe.found() && !lane.second) {
+          SlotList *alt = &segmensts_[getAltSegment(lane.keyval)];
+          lane.second = true;
+          if (alt != lane.segment) {
+            lane.segment = alt;
+            lane.started = false;
+            __builtin_prefetch(alt, 1);
+            continue;
+          }
+        }
+
+        // finished
+        if (lane.probe.found()) {
+          total++;
+        }
+        if (found) {
+          found[lane.index] = lane.probe.found();
+        }
+        if (!start(lane)) {
+          active--;
+        }
+      }
+    }
+    return total;
   }
   //-------------------------------------------------------------------------------------
   /**
@@ -167,6 +1041,37 @@ public:
     return total;
   }
   //-------------------------------------------------------------------------------------
+  /**
+   * @brief Resumable iteration (like Redis SCAN). Each call visits whole
+   * segments, starting at the cursor, until at least count objects are visited.
+   * Segments never move and each one is visited under its read lock, so every
+   * object that exists for the whole scan is visited exactly once, even with
+   * concurrent inserts, removes and expire checks. Objects added or removed
+   * during the scan may or may not be visited
+   *
+   * @param cursor 0 to start a new scan, otherwise the value returned by the
+   * previous call
+   * @param count minimum number of objects to visit (hint)
+   * @param func called for each object
+   * @param visited optional output, number of the visited objects
+   * @return uint64_t next cursor, 0 when the scan is finished
+   */
+  uint64_t scan(uint64_t cursor, size_t count, MatchFunc func,
+                size_t *visited = nullptr) const {
+    size_t total = 0;
+    uint64_t index = cursor;
+    while (index < SEGCOUNT) {
+      total += segmensts_[index++].forEach(func);
+      if (total >= count) {
+        break;
+      }
+    }
+    if (visited) {
+      *visited = total;
+    }
+    return (index < SEGCOUNT) ? index : 0;
+  }
+  //-------------------------------------------------------------------------------------
   /**
    * @brief
    *
@@ -175,31 +1080,407 @@ public:
    * @return size_t
    */
   size_t expireCheck(uint32_t cTime, MatchFunc func = nullptr) {
-    uint32_t index = (checkIndex_++) % SEGCOUNT;
+    ExpireCursor &cursor =
+        expireCursors_[utils::StripedCounter<>::threadIndex() %
+                       expireCursorsCount_];
+    uint32_t index = cursor.index.load(std::memory_order_relaxed);
+    cursor.index.store((index + 1) % SEGCOUNT, std::memory_order_relaxed);
 
     if (!cTime) {
-      cTime = libzrvan::utils::Time::getTime();
+      cTime = CLOCK::now();
     }
 
-    if (size_t ec = segmensts_[index].expireCheck(cTime, func); ec > 0) {
+    if (size_t ec = expireSegmentI(segmensts_[index], cTime, func); ec > 0) {
       count_ -= ec;
       return ec;
     }
     return 0;
   }
   //-------------------------------------------------------------------------------------
+  /**
+   * @brief Write a compact binary image of the map (keys, TTL informations and
+   * values) to the file. The segments are locked one by one in read mode, so
+   * writers are never blocked for long. The image is written to a temporary
+   * file and renamed at the end. T must be trivially copyable
+   *
+   * @param path
+   * @return true
+   * @return false
+   */
+  bool snapshot(const std::string &path) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "snapshot needs a trivially copyable value type");
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, snapshotMagic_, sizeof(header.magic));
+    header.version = snapshotVersion_;
+    header.segments = SEGCOUNT;
+    header.valueSize = sizeof(T);
+    header.clockUnits = CLOCK::unitsPerSecond;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<uint8_t> buffer;
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      uint32_t now = CLOCK::now();
+      buffer.clear();
+      SnapshotSegment seg = {i, 0};
+      segmensts_[i].dump([&](uint64_t key, T &item, uint32_t accessTime,
+                             uint32_t lifeTime) {
+        uint32_t age = now - accessTime;
+        size_t pos = buffer.size();
+        buffer.resize(pos + snapshotEntrySize_);
+        memcpy(&buffer[pos], &key, 8);
+        memcpy(&buffer[pos + 8], &lifeTime, 4);
+        memcpy(&buffer[pos + 12], &age, 4);
+        memcpy(&buffer[pos + 16], &item, sizeof(T));
+        seg.entries++;
+      });
+
+      if (seg.entries) {
+        out.write(reinterpret_cast<const char *>(&seg), sizeof(seg));
+        out.write(reinterpret_cast<const char *>(buffer.data()),
+                  buffer.size());
+        header.count += seg.entries;
+      }
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+      unlink(tmpPath.c_str());
+      return false;
+    }
+    return (rename(tmpPath.c_str(), path.c_str()) == 0);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Load an image created by snapshot. The file is memory mapped and
+   * the segment blocks are split between the threads, so the slots are rebuilt
+   * in parallel. The remaining TTL of each item is rebased to the current
+   * clock. The loaded items are added to the existing ones
+   *
+   * @param path
+   * @param threadsCount number of the loader threads
+   * @return true
+   * @return false if the file is missing or invalid, or it was written by a
+   * map with another value size or clock unit
+   */
+  bool load(const std::string &path, uint32_t threadsCount = 1) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "load needs a trivially copyable value type");
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+      close(fd);
+      return false;
+    }
+    size_t len = st.st_size;
+    void *mem = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+      return false;
+    }
+    madvise(mem, len, MADV_SEQUENTIAL);
+
+    // validate the header
+    const uint8_t *data = static_cast<const uint8_t *>(mem);
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, snapshotMagic_, sizeof(header.magic)) != 0 ||
+        header.version != snapshotVersion_ || header.valueSize != sizeof(T) ||
+        header.clockUnits != CLOCK::unitsPerSecond) {
+      munmap(mem, len);
+      return false;
+    }
+
+    // index the segment blocks
+    std::vector<std::pair<const uint8_t *, uint32_t>> blocks;
+    size_t pos = sizeof(header);
+    while (pos + sizeof(SnapshotSegment) <= len) {
+      SnapshotSegment seg;
+      memcpy(&seg, data + pos, sizeof(seg));
+      pos += sizeof(seg);
+      if (seg.entries > (len - pos) / snapshotEntrySize_) {
+        munmap(mem, len);
+        return false;
+      }
+      blocks.emplace_back(data + pos, seg.entries);
+      pos += seg.entries * snapshotEntrySize_;
+    }
+
+    // rebuild
+    uint32_t now = CLOCK::now();
+    auto loadFunc = [&](size_t first, size_t last) {
+      size_t cnt = 0;
+      for (size_t b = first; b < last; b++) {
+        const uint8_t *entry = blocks[b].first;
+        for (uint32_t e = 0; e < blocks[b].second; e++) {
+          uint64_t key;
+          uint32_t lifeTime;
+          uint32_t age;
+          T value;
+          memcpy(&key, entry, 8);
+          memcpy(&lifeTime, entry + 8, 4);
+          memcpy(&age, entry + 12, 4);
+          memcpy(&value, entry + 16, sizeof(T));
+          SlotList &segment = segmensts_[getInsertSegment(key)];
+          segment.restore(key, value, lifeTime, now - age);
+          evictedI(segment);
+          entry += snapshotEntrySize_;
+          cnt++;
+        }
+      }
+      count_ += cnt;
+    };
+
+    threadsCount = std::max<uint32_t>(1, threadsCount);
+    size_t chunk = (blocks.size() + threadsCount - 1) / threadsCount;
+    std::vector<std::thread> threads;
+    for (size_t first = 0; first < blocks.size(); first += chunk) {
+      threads.emplace_back(loadFunc, first,
+                           std::min(first + chunk, blocks.size()));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    munmap(mem, len);
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Attach a change feed. Insertions, updates (upsert, compute, touch),
+   * removals, expirations and evictions are appended to the feed under the
+   * segment locks, see ExpMapChangeFeed. It should be set before the map is
+   * shared between the threads
+   *
+   * @param feed it must outlive the map, nullptr detaches the current feed
+   */
+  void setChangeFeed(ChangeFeed *feed) {
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      segmensts_[i].setChangeFunction(nullptr);
+    }
+    if (!feed) {
+      return;
+    }
+    changeFunc_ = [feed](ExpChangeType type, uint64_t key, const T *object,
+                         uint32_t expTime) {
+      feed->append(type, key, object, expTime);
+    };
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      segmensts_[i].setChangeFunction(&changeFunc_);
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Apply a change of another map (standby side). Both maps must use the
+   * same HASH and CLOCK. Expirations and evictions are applied as removals
+   *
+   * @param change
+   * @return true if the map was changed
+   * @return false
+   */
+  bool applyChange(const Change &change) {
+    uint64_t keyval = change.key;
+    switch (change.type) {
+    case ExpChangeType::ADD: {
+      SlotList &segment = segmensts_[getInsertSegment(keyval)];
+      segment.add(keyval, change.value, change.expTime);
+      count_ += 1;
+      evictedI(segment);
+      return true;
+    }
+    case ExpChangeType::UPDATE:
+      updateI(keyval, [&](SlotList &segment) {
+        if (segment.upsert(keyval, change.value, change.expTime)) {
+          count_ += 1;
+          evictedI(segment);
+        }
+        return true;
+      });
+      return true;
+    default:
+      if (bothSegmentsI(keyval, [&](SlotList &segment) {
+            return segment.remove(keyval);
+          })) {
+        count_ -= 1;
+        return true;
+      }
+      return false;
+    }
+  }
+  //-------------------------------------------------------------------------------------
   /**
    * @brief Flush all the items and clean it
    *
    * @param func
    */
   void flush(MatchFunc func = nullptr) {
-    count_ = 0;
+    count_.reset();
     for (uint32_t i = 0; i < SEGCOUNT; i++) {
       segmensts_[i].flush(func);
     }
   }
   //-------------------------------------------------------------------------------------
+  /**
+   * @brief Parallel version of forEach. The segment range is split into chunks
+   * that run on the pool, so func is called from several threads at once
+   *
+   * @param pool
+   * @param func
+   * @param parallelism maximum number of the threads, 0 means the whole pool
+   * @return size_t
+   */
+  size_t forEachParallel(utils::ThreadPool &pool, MatchFunc func = nullptr,
+                         uint32_t parallelism = 0) const {
+    std::atomic<size_t> total = {0};
+    pool.parallelFor(
+        SEGCOUNT,
+        [&](size_t first, size_t last) {
+          size_t cnt = 0;
+          for (size_t i = first; i < last; i++) {
+            cnt += segmensts_[i].forEach(func);
+          }
+          total += cnt;
+        },
+        parallelism);
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Parallel version of flush, func is called from several threads at
+   * once
+   *
+   * @param pool
+   * @param func
+   * @param parallelism maximum number of the threads, 0 means the whole pool
+   */
+  void flushParallel(utils::ThreadPool &pool, MatchFunc func = nullptr,
+                     uint32_t parallelism = 0) {
+    count_.reset();
+    pool.parallelFor(
+        SEGCOUNT,
+        [&](size_t first, size_t last) {
+          for (size_t i = first; i < last; i++) {
+            segmensts_[i].flush(func);
+          }
+        },
+        parallelism);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Full expire sweep over all the segments in parallel. Like
+   * expireCheck, segments that are locked by other threads are skipped
+   *
+   * @param pool
+   * @param cTime
+   * @param func called from several threads at once
+   * @param parallelism maximum number of the threads, 0 means the whole pool
+   * @return size_t number of the removed items
+   */
+  size_t expireAll(utils::ThreadPool &pool, uint32_t cTime,
+                   MatchFunc func = nullptr, uint32_t parallelism = 0) {
+    std::atomic<size_t> total = {0};
+    if (!cTime) {
+      cTime = CLOCK::now();
+    }
+    pool.parallelFor(
+        SEGCOUNT,
+        [&](size_t first, size_t last) {
+          size_t cnt = 0;
+          for (size_t i = first; i < last; i++) {
+            cnt += expireSegmentI(segmensts_[i], cTime, func);
+          }
+          total += cnt;
+        },
+        parallelism);
+    count_ -= total;
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Collect the statistics. The segments are walked one by one under
+   * their read lock, so it is a slow operation. The runtime counters are only
+   * available if STATS is ExpMapStats
+   *
+   * @return ExpMapStatsSnapshot
+   */
+  ExpMapStatsSnapshot stats() {
+    ExpMapStatsSnapshot out;
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      size_t slots = segmensts_[i].slotsCount();
+      size_t items = segmensts_[i].size();
+      out.slots += slots;
+      out.items += items;
+      out.maxChainLength = std::max<uint32_t>(out.maxChainLength, slots);
+      out.chainHistogram[ExpMapStatsSnapshot::bucket(slots)]++;
+
+      // keep the most loaded segments, sorted
+      auto &hot = out.hotSegments;
+      if (items &&
+          (hot.size() < hotSegmentsCount_ || items > hot.back().second)) {
+        if (hot.size() == hotSegmentsCount_) {
+          hot.pop_back();
+        }
+        auto pos = std::find_if(hot.begin(), hot.end(),
+                                [&](auto &h) { return h.second < items; });
+        hot.insert(pos, {i, items});
+      }
+    }
+    out.bytes =
+        out.slots * SlotList::getSlotSize() + sizeof(SlotList) * SEGCOUNT;
+    out.fillRatio = out.slots ? double(out.items) / (out.slots * 64) : 0;
+    stats_.fill(out);
+    return out;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the effective capacity (0 means unbounded), the per segment
+   * bound times the segments count. It is the configured bound rounded down to
+   * a multiple of the segments count
+   *
+   * @return size_t
+   */
+  size_t getCapacity() const { return segmentCapacity_ * SEGCOUNT; }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the NUMA node that owns the key. Callers can use it to steer
+   * the work to a thread on the same node. It is always 0 if the map is not
+   * NUMA aware. In two choice mode it is the node of the first candidate
+   *
+   * @param key
+   * @return uint32_t
+   */
+  uint32_t getNode(const K &key) {
+    return getSegmentNode(getSegment(hash_(key)));
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the amount of the map memory (segments and slots) that is
+   * backed by huge pages. It reads /proc/self/smaps, so it is slow
+   *
+   * @return size_t
+   */
+  size_t getHugePageBytes() {
+    if (!hugePages_) {
+      return 0;
+    }
+    size_t total = utils::HugePage::hugeBytes(segmensts_, segmentsBytes_);
+    for (auto &upstream : nodeUpstreams_) {
+      total += upstream->hugeBytes();
+    }
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
   /**
    * @brief Get the Segments Count object
    *
@@ -208,11 +1489,31 @@ public:
   constexpr uint32_t getSegmentsCount() const { return SEGCOUNT; }
   //-------------------------------------------------------------------------------------
   /**
-   * @brief Get availabe items count
+   * @brief Get availabe items count. It is the sum of the per-thread counters,
+   * so it is approximate while the writers are active
    *
-   * @return constexpr uint32_t
+   * @return size_t
+   */
+  size_t size() const {
+    int64_t cnt = count_.get();
+    return (cnt > 0) ? cnt : 0;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the exact items count, the sum of the segment counters. It
+   * doesn't take the segment locks, so it doesn't block the writers and can be
+   * called from a forEach callback. The result is exact when no writer is
+   * active, otherwise each segment is counted at a slightly different time
+   *
+   * @return size_t
    */
-  constexpr size_t size() const { return count_; }
+  size_t exactSize() const {
+    size_t cnt = 0;
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      cnt += segmensts_[i].size();
+    }
+    return cnt;
+  }
 };
 } // namespace ds
 } // namespace libzrvan
\ No newline at end of file
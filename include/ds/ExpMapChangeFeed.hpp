@@ -0,0 +1,238 @@
+#pragma once
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "../utils/SpinLock.hpp"
+
+namespace libzrvan {
+namespace ds {
+
+/**
+ * @brief Type of the ExpMap changes
+ */
+enum class ExpChangeType : uint32_t { ADD, UPDATE, REMOVE, EXPIRE, EVICT };
+
+/**
+ * @brief One change of an ExpMap. The key is the hashed key, so the change can only be applied
+ * to a map that uses the same HASH (see ExpMap::applyChange)
+ *
+ * @tparam T object type
+ */
+template <class T>
+struct ExpChange {
+  // sequence number, per stripe
+  uint64_t seq = 0;
+  uint64_t key = 0;
+  ExpChangeType type = ExpChangeType::ADD;
+  uint32_t stripe = 0;
+  // TTL of ADD and UPDATE
+  uint32_t expTime = 0;
+  // object of ADD and UPDATE
+  T value = {};
+};
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Change feed of an ExpMap, for replicating it to a standby map with a cost that follows
+ * the write rate instead of the map size (see ExpMap::setChangeFeed).
+ *
+ * The changes are appended to sequenced bounded rings under the lock of the changed segment. The
+ * ring is selected by the key, so the changes of one key are always in order in one ring. If a
+ * ring is full the new changes are dropped and the feed is marked as overflowed, the consumer
+ * should then do a full resync (snapshot or forEach)
+ *
+ * - The changes made in place through findW (or findR) are not visible to the feed, use upsert,
+ * compute or findOrInsert
+ * - findOrInsert reports an ADD with the object left by func for a new key, and an UPDATE with
+ * the object left by func for an existing key if func is set (an existing key without func is
+ * only an access and is not reported)
+ * - The keys are replicated, not the objects identity, so the duplicate keys are not supported
+ *
+ * @tparam T object type
+ * @tparam STRIPES number of the rings
+ */
+template <class T, uint32_t STRIPES = 64>
+class ExpMapChangeFeed {
+ public:
+  using Change = ExpChange<T>;
+  using ChangeFunc = std::function<void(const Change&)>;
+
+ private:
+  struct alignas(64) Stripe {
+    libzrvan::utils::SpinLock<> lock;
+    std::vector<Change> ring;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint64_t seq = 0;
+    bool overflow = false;
+  };
+
+  Stripe stripes_[STRIPES];
+  size_t ringSize_;
+
+  //-------------------------------------------------------------------------------------
+  static inline uint32_t stripeOf(uint64_t key) { return (key ^ (key >> 32)) % STRIPES; }
+
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Exp Map Change Feed object
+   *
+   * @param ringSize capacity of each ring
+   */
+  explicit ExpMapChangeFeed(size_t ringSize = 16384) : ringSize_(ringSize) {
+    for (auto& stripe : stripes_) {
+      stripe.ring.resize(ringSize_);
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  ExpMapChangeFeed(const ExpMapChangeFeed&) = delete;
+  ExpMapChangeFeed(ExpMapChangeFeed&&) = delete;
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Append a change (producer side, called by the map)
+   *
+   * @param type
+   * @param key hashed key
+   * @param object object of ADD and UPDATE, nullptr otherwise
+   * @param expTime TTL of ADD and UPDATE
+   */
+  void append(ExpChangeType type, uint64_t key, const T* object, uint32_t expTime) {
+    uint32_t index = stripeOf(key);
+    Stripe& stripe = stripes_[index];
+    stripe.lock.lock();
+    uint64_t seq = ++stripe.seq;
+    if (stripe.tail - stripe.head == ringSize_) {
+      stripe.overflow = true;
+      stripe.lock.unlock();
+      return;
+    }
+    Change& change = stripe.ring[stripe.tail % ringSize_];
+    change.seq = seq;
+    change.key = key;
+    change.type = type;
+    change.stripe = index;
+    change.expTime = expTime;
+    if (object) {
+      change.value = *object;
+    }
+    stripe.tail++;
+    stripe.lock.unlock();
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Consume the pending changes. The changes of each ring are delivered in order
+   *
+   * @param func
+   * @param maxCount maximum number of the changes
+   * @return size_t number of the consumed changes
+   */
+  size_t drain(ChangeFunc func, size_t maxCount = SIZE_MAX) {
+    size_t cnt = 0;
+    Change change;
+    for (auto& stripe : stripes_) {
+      while (cnt < maxCount) {
+        stripe.lock.lock();
+        if (stripe.head == stripe.tail) {
+          stripe.lock.unlock();
+          break;
+        }
+        change = stripe.ring[stripe.head % ringSize_];
+        stripe.head++;
+        stripe.lock.unlock();
+        func(change);
+        cnt++;
+      }
+    }
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Check and clear the overflow flag
+   *
+   * @return true if some changes were dropped since the last call
+   * @return false
+   */
+  bool takeOverflow() {
+    bool res = false;
+    for (auto& stripe : stripes_) {
+      stripe.lock.lock();
+      res |= stripe.overflow;
+      stripe.overflow = false;
+      stripe.lock.unlock();
+    }
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the number of the pending changes
+   *
+   * @return size_t
+   */
+  size_t pending() {
+    size_t cnt = 0;
+    for (auto& stripe : stripes_) {
+      stripe.lock.lock();
+      cnt += stripe.tail - stripe.head;
+      stripe.lock.unlock();
+    }
+    return cnt;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Write a change to a pipe, socket or file. T must be trivially copyable
+   *
+   * @param fd
+   * @param change
+   * @return true
+   * @return false
+   */
+  static bool write(int fd, const Change& change) {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    const char* buffer = reinterpret_cast<const char*>(&change);
+    size_t done = 0;
+    while (done < sizeof(Change)) {
+      ssize_t res = ::write(fd, buffer + done, sizeof(Change) - done);
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      if (res <= 0) {
+        return false;
+      }
+      done += res;
+    }
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Read one change written by write
+   *
+   * @param fd
+   * @param change
+   * @return true
+   * @return false on the end of the stream or error
+   */
+  static bool read(int fd, Change& change) {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    char* buffer = reinterpret_cast<char*>(&change);
+    size_t done = 0;
+    while (done < sizeof(Change)) {
+      ssize_t res = ::read(fd, buffer + done, sizeof(Change) - done);
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      if (res <= 0) {
+        return false;
+      }
+      done += res;
+    }
+    return true;
+  }
+};
+
+}  // namespace ds
+}  // namespace libzrvan
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "../utils/Time.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Write-combining insert buffer for ExpMap. It collects the inserts of
+ * one thread, groups them by segment and adds each group under one segment
+ * lock. It also updates the map size once per flush instead of once per item.
+ *
+ * This object is not thread-safe, each writer thread should have its own
+ * buffer. Staged items are visible to the owner thread through findR
+ * (read-your-writes). Other threads see them after the flush, which happens
+ * when the buffer is full or when the oldest staged item is older than
+ * MAX_DELAY_MS (checked on add and poll)
+ *
+ * @tparam MAP ExpMap type
+ * @tparam CAPACITY maximum number of staged items
+ * @tparam MAX_DELAY_MS maximum staging delay in milliseconds
+ */
+template <class MAP, uint32_t CAPACITY = 256, uint32_t MAX_DELAY_MS = 10>
+class ExpMapInsertBuffer {
+public:
+  using K = typename MAP::KeyType;
+  using T = typename MAP::ValueType;
+  using MatchFunc = typename MAP::MatchFunc;
+
+private:
+  using InsertItem = typename MAP::InsertItem;
+
+  MAP &map_;
+  std::vector<InsertItem> items_;
+  uint64_t firstTime_ = 0;
+
+  //-------------------------------------------------------------------------------------
+  inline bool delayExpired() const {
+    return (!items_.empty() &&
+            libzrvan::utils::Time::getTimeMS() - firstTime_ >= MAX_DELAY_MS);
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new insert buffer for the map
+   *
+   * @param map
+   */
+  ExpMapInsertBuffer(MAP &map) : map_(map) { items_.reserve(CAPACITY); }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Disable copy and move constructor
+   *
+   */
+  ExpMapInsertBuffer(const ExpMapInsertBuffer &) = delete;
+  ExpMapInsertBuffer(ExpMapInsertBuffer &&) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Flush the staged items and destroy the buffer
+   *
+   */
+  ~ExpMapInsertBuffer() { flush(); }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Stage a new item
+   *
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true
+   * @return false
+   */
+  bool add(const K &key, const T &value, uint32_t expTime) {
+    if (items_.empty()) {
+      firstTime_ = libzrvan::utils::Time::getTimeMS();
+    }
+    items_.emplace_back(map_.makeInsertItem(key, value, expTime));
+    if (items_.size() >= CAPACITY || delayExpired()) {
+      flush();
+    }
+    return true;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Flush the staged items if the staging delay is expired. It should be
+   * called periodically when the thread is idle
+   *
+   * @return size_t number of flushed items
+   */
+  size_t poll() { return delayExpired() ? flush() : 0; }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add all the staged items to the map
+   *
+   * @return size_t number of flushed items
+   */
+  size_t flush() {
+    if (items_.empty()) {
+      return 0;
+    }
+
+    std::stable_sort(items_.begin(), items_.end(),
+                     [](const InsertItem &a, const InsertItem &b) {
+                       return a.segment < b.segment;
+                     });
+    size_t cnt = map_.addGroup(items_.data(), items_.size());
+    items_.clear();
+    return cnt;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Read-only lookup. Staged items are checked first (newest first) and
+   * then the map
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool findR(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = map_.hashKey(key);
+    for (auto it = items_.rbegin(); it != items_.rend(); ++it) {
+      if (it->key == keyval && (!func || func(it->object))) {
+        return true;
+      }
+    }
+    return map_.findR(key, func);
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the staged items count
+   *
+   * @return size_t
+   */
+  size_t size() const { return items_.size(); }
+};
+} // namespace ds
+} // namespace libzrvan
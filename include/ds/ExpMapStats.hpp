@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../utils/StripedCounter.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Snapshot of the ExpMap statistics, see ExpMap::stats. The structure metrics (items,
+ * slots, chains) are always available, the runtime counters are only filled if the map uses
+ * ExpMapStats. Histograms use log2 buckets: bucket 0 is 0, bucket n is [2^(n-1), 2^n)
+ */
+struct ExpMapStatsSnapshot {
+  static constexpr uint32_t histogramSize = 16;
+  using Histogram = std::array<uint64_t, histogramSize>;
+
+  // structure
+  size_t items = 0;
+  size_t slots = 0;
+  size_t bytes = 0;
+  double fillRatio = 0;
+  uint32_t maxChainLength = 0;
+  Histogram chainHistogram = {};
+  // most loaded segments (segment, items)
+  std::vector<std::pair<uint32_t, size_t>> hotSegments;
+
+  // runtime counters
+  uint64_t finds = 0;
+  uint64_t findHits = 0;
+  Histogram probeHistogram = {};
+  uint64_t expireChecks = 0;
+  uint64_t expireLockLost = 0;
+  uint64_t expired = 0;
+  Histogram expireLagHistogram = {};
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the histogram bucket of a value
+   *
+   * @param value
+   * @return uint32_t
+   */
+  static uint32_t bucket(uint64_t value) {
+    if (!value) {
+      return 0;
+    }
+    return std::min<uint32_t>(histogramSize - 1, 64 - __builtin_clzll(value));
+  }
+};
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Default statistics policy, it doesn't record anything
+ */
+struct NoStats {
+  static constexpr bool enabled = false;
+  inline void onFind(uint32_t, bool) {}
+  inline void onExpireCheck(bool, size_t, uint32_t) {}
+  inline void fill(ExpMapStatsSnapshot&) {}
+};
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Statistics policy that records the lookups probe length (slots walked), the
+ * expire checks and the expiry lag (time between the expiration and the removal, in the map
+ * clock units). It uses utils::StripedCounter objects (one cache line per thread stripe), so
+ * the hot path doesn't touch a shared cache line up to 64 threads, and any number of threads
+ * can record
+ */
+class ExpMapStats {
+ private:
+  using CounterType = libzrvan::utils::StripedCounter<>;
+  static constexpr uint32_t histogramSize_ = ExpMapStatsSnapshot::histogramSize;
+
+  CounterType finds_;
+  CounterType findHits_;
+  CounterType expireChecks_;
+  CounterType expireLockLost_;
+  CounterType expired_;
+  CounterType probes_[histogramSize_];
+  CounterType expireLags_[histogramSize_];
+
+ public:
+  static constexpr bool enabled = true;
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param probes number of the walked slots
+   * @param found
+   */
+  inline void onFind(uint32_t probes, bool found) {
+    finds_ += 1;
+    if (found) {
+      findHits_ += 1;
+    }
+    probes_[ExpMapStatsSnapshot::bucket(probes)] += 1;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param lockLost the segment was locked by another thread
+   * @param expired number of the removed objects
+   * @param maxLag maximum expiry lag of the removed objects
+   */
+  inline void onExpireCheck(bool lockLost, size_t expired, uint32_t maxLag) {
+    expireChecks_ += 1;
+    if (lockLost) {
+      expireLockLost_ += 1;
+    }
+    if (expired) {
+      expired_ += expired;
+      expireLags_[ExpMapStatsSnapshot::bucket(maxLag)] += 1;
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Copy the counters to the snapshot
+   *
+   * @param out
+   */
+  void fill(ExpMapStatsSnapshot& out) {
+    out.finds = finds_.get();
+    out.findHits = findHits_.get();
+    out.expireChecks = expireChecks_.get();
+    out.expireLockLost = expireLockLost_.get();
+    out.expired = expired_.get();
+    for (uint32_t i = 0; i < histogramSize_; i++) {
+      out.probeHistogram[i] = probes_[i].get();
+      out.expireLagHistogram[i] = expireLags_[i].get();
+    }
+  }
+};
+
+}  // namespace ds
+}  // namespace libzrvan
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ExpMap.hpp"
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Thread-safe set with the expiration capability, for the "has this key
+ * been seen in the last N seconds" use cases (dedup, connection tracking). It
+ * is an ExpMap with an empty value type, ExpSlotList stores empty types as a
+ * base class, so each entry only keeps the key and the TTL informations (16
+ * bytes)
+ *
+ * @tparam K key type class
+ * @tparam HASH
+ * @tparam SEGCOUNT hash segment count
+ * @tparam EXTEND_LIFE_ON_ACCESS considering the expiration time after the last
+ * access instead of an absolute value
+ * @tparam PRELOAD Preloading the hash segments
+ * @tparam LOCK segments lock
+ * @tparam EVICTION eviction policy used when a capacity is set
+ * @tparam CLOCK time base of the TTLs
+ */
+template <class K, class HASH = utils::FastHash<K>, uint32_t SEGCOUNT = 256000,
+          bool EXTEND_LIFE_ON_ACCESS = true, bool PRELOAD = true,
+          class LOCK = libzrvan::utils::RWSpinLock<>,
+          class EVICTION = NoEviction, class CLOCK = SecondsClock>
+class ExpSet {
+private:
+  struct Entry {};
+  using Map = ExpMap<K, Entry, HASH, SEGCOUNT, EXTEND_LIFE_ON_ACCESS, PRELOAD,
+                     LOCK, EVICTION, NoStats, CLOCK>;
+  Map map_;
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Exp Set object
+   *
+   * @param options see ExpMapOptions
+   */
+  ExpSet(const ExpMapOptions &options = ExpMapOptions()) : map_(options) {}
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add the key if it is not in the set. If the key exists it is
+   * considered as an access (the TTL is extended if EXTEND_LIFE_ON_ACCESS is
+   * set)
+   *
+   * @param key
+   * @param expTime
+   * @return true if the key was new
+   * @return false
+   */
+  bool insertIfAbsent(const K &key, uint32_t expTime) {
+    return map_.findOrInsert(key, [] { return Entry(); }, expTime);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @return true
+   * @return false
+   */
+  bool contains(const K &key) { return map_.findR(key); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @return true
+   * @return false
+   */
+  bool remove(const K &key) { return map_.remove(key); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Restart the TTL of the key with a new TTL value
+   *
+   * @param key
+   * @param expTime
+   * @return true
+   * @return false
+   */
+  bool touch(const K &key, uint32_t expTime) {
+    return map_.touch(key, expTime);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param cTime
+   * @return size_t
+   */
+  size_t expireCheck(uint32_t cTime) { return map_.expireCheck(cTime); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Flush all the keys
+   *
+   */
+  void flush() { map_.flush(); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief see ExpMap::stats
+   *
+   * @return ExpMapStatsSnapshot
+   */
+  ExpMapStatsSnapshot stats() { return map_.stats(); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get availabe keys count
+   *
+   * @return size_t
+   */
+  size_t size() const { return map_.size(); }
+};
+} // namespace ds
+} // namespace libzrvan
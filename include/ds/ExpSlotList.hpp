@@ -1,13 +1,39 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
 #include "../utils/RWSpinLock.hpp"
 #include "../utils/StaticLoop.hpp"
 #include "../utils/Time.hpp"
+#include "ExpClock.hpp"
+#include "ExpEviction.hpp"
+#include "ExpMapChangeFeed.hpp"
 namespace libzrvan {
 namespace ds {
 
+/**
+ * @brief Object holder of the slot entries. Empty object types (see ExpSet) are stored as a
+ * base class, so they don't take any space in the slot
+ *
+ * @tparam T object type
+ */
+template <class T, bool EMPTY = std::is_empty_v<T> && !std::is_final_v<T>>
+struct ExpSlotItem {
+  T item;
+  inline T& value() { return item; }
+};
+template <class T>
+struct ExpSlotItem<T, true> : T {
+  inline T& value() { return *this; }
+};
+
 /**
  * @brief Thread-safe slot-link list with expiration capability. like many other tools in
  * this library, it uses high memory to increase performance. It uses 2 separate lists,
@@ -25,14 +51,61 @@ namespace ds {
  *
  * if EXTEND_LIFE_ON_ACCESS equal true the DS extend the lifetime of the object after each access
  * by the defined interval
+ *
+ * If a capacity is set (setCapacity), the EVICTION policy removes one object before each insertion
+ * that would exceed it
+ *
+ * The times (TTLs, access times and the expire check time) are in the units of CLOCK, seconds or
+ * milliseconds (see ExpClock.hpp)
  */
-template <class T, bool EXTEND_LIFE_ON_ACCESS = true,class LOCK=libzrvan::utils::RWSpinLock<>>
+template <class T, bool EXTEND_LIFE_ON_ACCESS = true,class LOCK=libzrvan::utils::RWSpinLock<>,
+          class EVICTION = NoEviction, class CLOCK = SecondsClock>
 class ExpSlotList {
  public:
   /**
    * @brief Match function. Allowing access to the stored object in the list in read-only mode
    */
   using MatchFunction = std::function<bool(T&)>;
+  /**
+   * @brief Factory function. Used to create a new object when the key does not exist
+   */
+  using FactoryFunction = std::function<T()>;
+  /**
+   * @brief Compute function. It is called with the stored object (exists == true) or a default
+   * constructed object (exists == false). Returning false removes the existing object or skips
+   * the insertion
+   */
+  using ComputeFunction = std::function<bool(T&, bool exists)>;
+  /**
+   * @brief Entry function. Allowing access to the stored object with its key and TTL
+   * informations (key, object, access time, lifetime)
+   */
+  using EntryFunction = std::function<void(uint64_t, T&, uint32_t, uint32_t)>;
+  /**
+   * @brief Change function, called under the lock for each change of the list (see
+   * setChangeFunction). object and expTime are only set for ADD and UPDATE
+   */
+  using ChangeFunction =
+      std::function<void(ExpChangeType, uint64_t key, const T* object, uint32_t expTime)>;
+  /**
+   * @brief Result of the compute operation
+   */
+  enum class ComputeResult { NONE, INSERTED, UPDATED, REMOVED };
+  /**
+   * @brief Optional details of the expire check
+   */
+  struct ExpireInfo {
+    // the list was locked by another thread, nothing was checked
+    bool lockLost = false;
+    // maximum delay between the expiration and the removal of the removed objects
+    uint32_t maxLag = 0;
+  };
+  /**
+   * @brief One cache line of the optional Bloom filter, see setBloomFilter
+   */
+  struct alignas(64) BloomBlock {
+    std::atomic<uint64_t> words[8];
+  };
 
  private:
   /**
@@ -42,13 +115,12 @@ class ExpSlotList {
    * @tparam T object type
    */
   class Slot {
-   private:
+   public:
     /**
      * @brief Hold object + TTL informations
      *
      */
-    struct SlotDataInfo {
-      T item;
+    struct SlotDataInfo : ExpSlotItem<T> {
       uint32_t accessTime;
       uint32_t lifeTime;
     };
@@ -61,10 +133,34 @@ class ExpSlotList {
     uint64_t keyList_[maxSlotItems_];
     SlotDataInfo itemsList_[maxSlotItems_];
     uint64_t slotMask_ = 0;
+    uint64_t refMask_ = 0;
     Slot* next_ = nullptr;
     Slot* prev_ = nullptr;
 
    public:
+    //------------------------------------------------------------------------------------
+    Slot() = default;
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Construct a new Slot object. If the object type is allocator-aware (std::pmr
+     * containers for example), the objects are created with the memory resource, so their
+     * out-of-line data is also allocated from it
+     *
+     * @param resource
+     */
+    explicit Slot(std::pmr::memory_resource* resource) {
+      using Alloc = std::pmr::polymorphic_allocator<std::byte>;
+      if constexpr (std::uses_allocator_v<T, Alloc>) {
+        for (auto& info : itemsList_) {
+          info.value().~T();
+          if constexpr (std::is_constructible_v<T, std::allocator_arg_t, Alloc>) {
+            new (&info.value()) T(std::allocator_arg, Alloc(resource));
+          } else {
+            new (&info.value()) T(Alloc(resource));
+          }
+        }
+      }
+    }
     //------------------------------------------------------------------------------------
     /**
      * @brief Add a new object to the slot
@@ -76,27 +172,40 @@ class ExpSlotList {
      * @return false
      */
     inline bool add(uint64_t key, const T& object, uint32_t expTime) {
+      return (insert(key, object, expTime) != nullptr);
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Add a new object to the slot and return its storage
+     *
+     * @param key object key
+     * @param object
+     * @param expTime TTL value
+     * @return SlotDataInfo* stored object or nullptr if the slot is full
+     */
+    inline SlotDataInfo* insert(uint64_t key, const T& object, uint32_t expTime) {
       //
       auto addFunc = [&](uint32_t index, uint64_t mask) {
         keyList_[index] = key;
-        itemsList_[index].item = object;
+        itemsList_[index].value() = object;
         itemsList_[index].lifeTime = expTime;
-        itemsList_[index].accessTime = libzrvan::utils::Time::getTime();
+        itemsList_[index].accessTime = CLOCK::now();
         slotMask_ |= mask;
+        refMask_ &= ~mask;
       };
       //
       if (full()) {
-        return false;
+        return nullptr;
       }
 
       // loop
       __SLOTLIST_STATIC_LOOP_FUNC({
         if ((_static_mask & slotMask_) == 0) {
           addFunc(_static_index, _static_mask);
-          return true;
+          return &itemsList_[_static_index];
         }
       });
-      return false;
+      return nullptr;
     }
     //------------------------------------------------------------------------------------
     /**
@@ -111,7 +220,7 @@ class ExpSlotList {
     inline bool remove(uint64_t key, MatchFunction matchFunc = nullptr) {
       //
       auto checkMatchFunc = [&](uint32_t index, uint64_t mask) -> bool {
-        if (matchFunc && !matchFunc(itemsList_[index].item)) {
+        if (matchFunc && !matchFunc(itemsList_[index].value())) {
           return false;
         }
         slotMask_ &= ~mask;
@@ -143,14 +252,14 @@ class ExpSlotList {
     inline bool find(uint64_t key, MatchFunction findFunc = nullptr) {
       //
       auto checkMatchFunc = [&](uint32_t index) -> bool {
-        if (findFunc && !findFunc(itemsList_[index].item)) {
+        if (findFunc && !findFunc(itemsList_[index].value())) {
           return false;
         }
 
         if (EXTEND_LIFE_ON_ACCESS) {
-          itemsList_[index].accessTime = libzrvan::utils::Time::getTime();
+          itemsList_[index].accessTime = CLOCK::now();
         }
-
+        reference(index);
         return true;
       };
 
@@ -164,6 +273,91 @@ class ExpSlotList {
       return false;
     }
     //------------------------------------------------------------------------------------
+    // true if the slot has an object with the given key
+    inline bool contains(uint64_t key) const {
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if (key == keyList_[_static_index] && (_static_mask & slotMask_)) {
+          return true;
+        }
+      });
+      return false;
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Find the first object with the given key and return its storage
+     *
+     * @param key object key
+     * @return SlotDataInfo* stored object or nullptr
+     */
+    inline SlotDataInfo* get(uint64_t key) {
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if (key == keyList_[_static_index] && (_static_mask & slotMask_)) {
+          reference(_static_index);
+          return &itemsList_[_static_index];
+        }
+      });
+      return nullptr;
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Visit all the objects with the given key
+     *
+     * @param key object key
+     * @param func called for each object, returning false stops the visit
+     * @param stopped set to true if func stopped the visit
+     * @return size_t number of visited objects
+     */
+    inline size_t findAll(uint64_t key, const MatchFunction& func, bool& stopped) {
+      size_t count = 0;
+      if (empty()) {
+        return 0;
+      }
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if (key == keyList_[_static_index] && (_static_mask & slotMask_)) {
+          count++;
+          if (EXTEND_LIFE_ON_ACCESS) {
+            itemsList_[_static_index].accessTime = CLOCK::now();
+          }
+          reference(_static_index);
+          if (func && !func(itemsList_[_static_index].value())) {
+            stopped = true;
+            return count;
+          }
+        }
+      })
+      return count;
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Remove all the objects with the given key
+     *
+     * @param key object key
+     * @param matchFunc the object is removed only if this function returns true
+     * @return size_t number of removed objects
+     */
+    inline size_t removeAll(uint64_t key, MatchFunction matchFunc = nullptr) {
+      size_t count = 0;
+      //
+      auto checkMatchFunc = [&](uint32_t index, uint64_t mask) {
+        if (matchFunc && !matchFunc(itemsList_[index].value())) {
+          return;
+        }
+        slotMask_ &= ~mask;
+        count++;
+      };
+
+      if (empty()) {
+        return 0;
+      }
+
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if (key == keyList_[_static_index] && (_static_mask & slotMask_)) {
+          checkMatchFunc(_static_index, _static_mask);
+        }
+      })
+      return count;
+    }
+    //------------------------------------------------------------------------------------
     /**
      * @brief Iterating through all the objects in the list
      *
@@ -176,7 +370,7 @@ class ExpSlotList {
       //
       auto callFunc = [&](uint32_t index) -> bool {
         if (matchFunc) {
-          matchFunc(itemsList_[index].item);
+          matchFunc(itemsList_[index].value());
         }
         cnt++;
         return false;
@@ -192,6 +386,25 @@ class ExpSlotList {
       return cnt;
     }
     //------------------------------------------------------------------------------------
+    /**
+     * @brief Iterating through all the objects in the slot with their keys and TTL
+     * informations
+     *
+     * @param func
+     * @return size_t number of items
+     */
+    inline size_t forEachEntry(const EntryFunction& func) {
+      size_t cnt = 0;
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if ((_static_mask & slotMask_)) {
+          SlotDataInfo* info = &itemsList_[_static_index];
+          func(keyList_[_static_index], info->value(), info->accessTime, info->lifeTime);
+          cnt++;
+        }
+      });
+      return cnt;
+    }
+    //------------------------------------------------------------------------------------
     /**
      * @brief
      *
@@ -208,25 +421,107 @@ class ExpSlotList {
      */
     inline bool full() const { return slotMask_ == slotFullFlag_; }
     //------------------------------------------------------------------------------------
+    /**
+     * @brief Set the reference bit of the object (CLOCK eviction only). It may be called
+     * under the read lock, so it is an atomic operation
+     *
+     * @param index
+     */
+    inline void reference(uint32_t index) {
+      if constexpr (EVICTION::type == EvictionType::CLOCK) {
+        if (!(refMask_ & (1ULL << index))) {
+          __atomic_fetch_or(&refMask_, (1ULL << index), __ATOMIC_RELAXED);
+        }
+      }
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Find the least recently accessed object of the slot
+     *
+     * @param now current time
+     * @param age in: the best age (time since the last access) so far, out: the new best age
+     * @return int index of the object if it is older than (or as old as) age, -1 otherwise
+     */
+    inline int leastRecent(uint32_t now, uint32_t& age) const {
+      int res = -1;
+      __SLOTLIST_STATIC_LOOP_FUNC({
+        if ((_static_mask & slotMask_) && now - itemsList_[_static_index].accessTime >= age) {
+          age = now - itemsList_[_static_index].accessTime;
+          res = _static_index;
+        }
+      });
+      return res;
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Move the CLOCK hand over the slot objects, starting from index. Referenced
+     * objects lose their reference bit, the first one without it is evicted
+     *
+     * @param index start index
+     * @return int index of the evicted object or -1 if the hand reached the end of the slot
+     */
+    inline int clockSweep(uint32_t index) {
+      for (; index < maxSlotItems_; index++) {
+        uint64_t mask = (1ULL << index);
+        if (!(slotMask_ & mask)) {
+          continue;
+        }
+        if (refMask_ & mask) {
+          refMask_ &= ~mask;
+          continue;
+        }
+        slotMask_ &= ~mask;
+        return index;
+      }
+      return -1;
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Remove the object at the index
+     *
+     * @param index
+     */
+    inline void evict(uint32_t index) {
+      slotMask_ &= ~(1ULL << index);
+      refMask_ &= ~(1ULL << index);
+    }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Get the key at the index
+     *
+     * @param index
+     * @return uint64_t
+     */
+    inline uint64_t keyAt(uint32_t index) const { return keyList_[index]; }
+    //------------------------------------------------------------------------------------
     /**
      * @brief
      *
      * @param ctime current time  (relative time)
      * @param matchFunc Remove the expired object from the list if this function returns true
+     * @param maxLag optional, maximum expiry lag of the removed objects
+     * @param change optional, called for each removed object
      * @return size_t
      */
-    inline size_t expireCheck(uint32_t ctime, MatchFunction matchFunc = nullptr) {
+    inline size_t expireCheck(uint32_t ctime, MatchFunction matchFunc = nullptr,
+                              uint32_t* maxLag = nullptr, const ChangeFunction* change = nullptr) {
       size_t count = 0;
 
       //
       auto checkFunc = [&](uint32_t index, uint64_t mask) {
         SlotDataInfo* info = &itemsList_[index];
         if (ctime - info->accessTime > info->lifeTime) {
-          if (matchFunc && !matchFunc(itemsList_[index].item)) {
+          if (matchFunc && !matchFunc(itemsList_[index].value())) {
             return;
           }
           slotMask_ &= ~mask;
           count++;
+          if (maxLag) {
+            *maxLag = std::max(*maxLag, ctime - info->accessTime - info->lifeTime);
+          }
+          if (change) {
+            (*change)(ExpChangeType::EXPIRE, keyList_[index], nullptr, 0);
+          }
         }
       };
 
@@ -249,7 +544,8 @@ class ExpSlotList {
         next_ = root;
         root->prev_ = this;
       }
-      root = this;
+      // prefetch reads the root without the lock
+      __atomic_store_n(&root, this, __ATOMIC_RELAXED);
     }
     //------------------------------------------------------------------------------------
     /**
@@ -267,7 +563,7 @@ class ExpSlotList {
       }
 
       if (root == this) {
-        root = next_;
+        __atomic_store_n(&root, next_, __ATOMIC_RELAXED);
       }
     }
     //------------------------------------------------------------------------------------
@@ -277,43 +573,303 @@ class ExpSlotList {
      * @return next slot in the list
      */
     inline Slot* next() { return next_; }
+    //------------------------------------------------------------------------------------
+    /**
+     * @brief Prefetch the keys array into the CPU cache
+     *
+     */
+    inline void prefetch() const {
+      for (uint32_t i = 0; i < maxSlotItems_; i += (64 / sizeof(uint64_t))) {
+        __builtin_prefetch(&keyList_[i]);
+      }
+    }
   };
 
  private:
+  using SlotDataInfo = typename Slot::SlotDataInfo;
+
   LOCK lock_;
   ExpSlotList::Slot* root_ = nullptr;
-  size_t count_ = 0;
+  // written under the lock, read relaxed without it (size)
+  std::atomic<size_t> count_ = {0};
+  std::pmr::memory_resource* resource_ = nullptr;
+  // allocated slots
+  size_t slots_ = 0;
+  // eviction
+  size_t capacity_ = 0;
+  size_t maxSlots_ = 0;
+  uint32_t clockHand_ = 0;
+  std::atomic<size_t> evicted_ = {0};
+  // optional Bloom filter, the blocks are owned by the caller
+  static constexpr uint32_t bloomHashes_ = 4;
+  static constexpr size_t bloomMinStale_ = 16;
+  BloomBlock* bloom_ = nullptr;
+  std::unique_ptr<uint64_t[]> bloomScratch_;
+  uint32_t bloomMask_ = 0;
+  size_t bloomStale_ = 0;
+  // optional change function, owned by the caller
+  const ChangeFunction* change_ = nullptr;
+  //------------------------------------------------------------------------------------
+  // the writers hold the lock, a relaxed load and store is enough
+  inline void addCountI(ptrdiff_t val) {
+    count_.store(count_.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+  }
+  //------------------------------------------------------------------------------------
+  inline void changedI(ExpChangeType type, uint64_t key, const T* object = nullptr,
+                       uint32_t expTime = 0) {
+    if (change_) {
+      (*change_)(type, key, object, expTime);
+    }
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief The keys are hashes already, but they may be used for the segment selection too
+   * (ExpMap), so they are mixed again. The low bits select the block and each 9 bits of the
+   * high part select one bit of the block
+   */
+  static inline uint64_t bloomHash(uint64_t key) {
+    key = (key ^ (key >> 31)) * 0x7fb5d329728ea185;
+    return key ^ (key >> 27);
+  }
+  //------------------------------------------------------------------------------------
+  inline void bloomAddI(uint64_t key) {
+    if (!bloom_) {
+      return;
+    }
+    uint64_t hash = bloomHash(key);
+    BloomBlock& block = bloom_[hash & bloomMask_];
+    for (uint32_t i = 0; i < bloomHashes_; i++) {
+      uint32_t bit = (hash >> (28 + i * 9)) & 511;
+      // writers hold the lock, readers only need to see whole words
+      std::atomic<uint64_t>& word = block.words[bit / 64];
+      word.store(word.load(std::memory_order_relaxed) | (1ULL << (bit % 64)),
+                 std::memory_order_relaxed);
+    }
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Rebuild the filter from the current keys. It is built aside and copied word by
+   * word, each word is a superset of the bits of the current keys in both versions, so the
+   * lock-free readers never see a false negative
+   */
+  void bloomRebuildI() {
+    // the filter is built aside in the scratch buffer, so the lock-free readers never see a
+    // cleared bit of a live object
+    size_t size = size_t(bloomMask_ + 1) * 8;
+    uint64_t* words = bloomScratch_.get();
+    std::fill(words, words + size, 0);
+    EntryFunction func = [this, words](uint64_t key, T&, uint32_t, uint32_t) {
+      uint64_t hash = bloomHash(key);
+      uint64_t* block = &words[(hash & bloomMask_) * 8];
+      for (uint32_t i = 0; i < bloomHashes_; i++) {
+        uint32_t bit = (hash >> (28 + i * 9)) & 511;
+        block[bit / 64] |= (1ULL << (bit % 64));
+      }
+    };
+    for (ExpSlotList::Slot* slot = root_; slot; slot = slot->next()) {
+      slot->forEachEntry(func);
+    }
+    for (size_t i = 0; i < size; i++) {
+      bloom_[i / 8].words[i % 8].store(words[i], std::memory_order_relaxed);
+    }
+    bloomStale_ = 0;
+  }
+  //------------------------------------------------------------------------------------
+  void bloomClearI() {
+    for (uint32_t b = 0; b <= bloomMask_; b++) {
+      for (auto& word : bloom_[b].words) {
+        word.store(0, std::memory_order_relaxed);
+      }
+    }
+    bloomStale_ = 0;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Account the removed objects. The filter is rebuilt when the removed objects
+   * outnumber the live ones
+   */
+  inline void bloomRemovedI(size_t cnt) {
+    if (!bloom_ || !cnt) {
+      return;
+    }
+    bloomStale_ += cnt;
+    if (bloomStale_ >= bloomMinStale_ && bloomStale_ > count_.load(std::memory_order_relaxed)) {
+      bloomRebuildI();
+    }
+  }
   //------------------------------------------------------------------------------------
-  inline bool findI(uint64_t key, MatchFunction func) {
+  inline bool findI(uint64_t key, MatchFunction func, uint32_t* probes = nullptr) {
     ExpSlotList::Slot* slot = root_;
+    uint32_t cnt = 0;
+    bool res = false;
     while (slot) {
+      cnt++;
       if (slot->find(key, func)) {
-        return true;
+        res = true;
+        break;
       }
       slot = slot->next();
     }
-    return false;
+    if (probes) {
+      *probes = cnt;
+    }
+    return res;
   }
   //------------------------------------------------------------------------------------
   inline ExpSlotList::Slot* addNewSlot() {
     ExpSlotList::Slot* slot;
-    slot = new ExpSlotList::Slot();
+    if (resource_) {
+      slot = new (resource_->allocate(sizeof(Slot), alignof(Slot))) ExpSlotList::Slot(resource_);
+    } else {
+      slot = new ExpSlotList::Slot();
+    }
     slot->addToChain(root_);
+    slots_++;
     return slot;
   }
   //------------------------------------------------------------------------------------
+  inline void freeSlot(ExpSlotList::Slot* slot) {
+    slots_--;
+    if (resource_) {
+      slot->~Slot();
+      resource_->deallocate(slot, sizeof(Slot), alignof(Slot));
+    } else {
+      delete slot;
+    }
+  }
+  //------------------------------------------------------------------------------------
   inline bool addI(uint64_t key, const T& object, uint32_t expTime) {
+    return (insertI(key, object, expTime) != nullptr);
+  }
+  //------------------------------------------------------------------------------------
+  inline bool evictLRUI() {
+    ExpSlotList::Slot* victim = nullptr;
+    int victimIndex = -1;
+    uint32_t now = CLOCK::now();
+    uint32_t age = 0;
+    for (ExpSlotList::Slot* slot = root_; slot; slot = slot->next()) {
+      if (int index = slot->leastRecent(now, age); index >= 0) {
+        victim = slot;
+        victimIndex = index;
+      }
+    }
+    if (!victim) {
+      return false;
+    }
+    changedI(ExpChangeType::EVICT, victim->keyAt(victimIndex));
+    victim->evict(victimIndex);
+    if (victim->empty()) {
+      victim->removeFromChain(root_);
+      freeSlot(victim);
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------
+  inline bool evictClockI() {
+    // the hand is a position in the chain (slot ordinal, index). New slots are added to the
+    // head, so the hand drifts a little, which only changes the sweep order
+    uint32_t ordinal = clockHand_ / 64;
+    uint32_t index = clockHand_ % 64;
+    uint32_t wraps = 0;
     ExpSlotList::Slot* slot = root_;
-    // add to existings items
+    for (uint32_t i = 0; slot && i < ordinal; i++) {
+      slot = slot->next();
+    }
+    if (!slot) {
+      slot = root_;
+      ordinal = index = 0;
+    }
 
-    if (slot && !slot->full() && slot->add(key, object, expTime)) {
-      return true;
+    // the first lap may only clear the reference bits
+    while (slot && wraps < 3) {
+      if (int victim = slot->clockSweep(index); victim >= 0) {
+        changedI(ExpChangeType::EVICT, slot->keyAt(victim));
+        clockHand_ = ordinal * 64 + victim + 1;
+        if (slot->empty()) {
+          slot->removeFromChain(root_);
+          freeSlot(slot);
+          clockHand_ = ordinal * 64;
+        }
+        return true;
+      }
+      slot = slot->next();
+      ordinal++;
+      index = 0;
+      if (!slot) {
+        slot = root_;
+        ordinal = 0;
+        wraps++;
+      }
+    }
+    return false;
+  }
+  //------------------------------------------------------------------------------------
+  inline void evictI() {
+    if constexpr (EVICTION::type != EvictionType::NONE) {
+      if (!capacity_ || count_.load(std::memory_order_relaxed) < capacity_) {
+        return;
+      }
+      bool res;
+      if constexpr (EVICTION::type == EvictionType::LRU) {
+        res = evictLRUI();
+      } else {
+        res = evictClockI();
+      }
+      if (res) {
+        addCountI(-1);
+        evicted_.fetch_add(1, std::memory_order_relaxed);
+        bloomRemovedI(1);
+      }
     }
+  }
+  //------------------------------------------------------------------------------------
+  inline SlotDataInfo* insertI(uint64_t key, const T& object, uint32_t expTime,
+                               bool report = true) {
+    ExpSlotList::Slot* slot;
+    SlotDataInfo* info;
 
-    // add new item
-    slot = addNewSlot();
-    slot->add(key, object, expTime);
-    return true;
+    evictI();
+    bloomAddI(key);
+    slot = root_;
+    // add to existings items
+
+    if (!slot || slot->full() || !(info = slot->insert(key, object, expTime))) {
+      info = nullptr;
+      // slots bound, reuse the holes of the chain
+      if (maxSlots_ && slots_ >= maxSlots_) {
+        for (slot = root_; slot && !info; slot = slot->next()) {
+          if (!slot->full()) {
+            info = slot->insert(key, object, expTime);
+          }
+        }
+      }
+      // add new item
+      if (!info) {
+        slot = addNewSlot();
+        info = slot->insert(key, object, expTime);
+      }
+    }
+    if (report) {
+      changedI(ExpChangeType::ADD, key, &object, expTime);
+    }
+    return info;
+  }
+  //------------------------------------------------------------------------------------
+  inline SlotDataInfo* getI(uint64_t key) {
+    ExpSlotList::Slot* slot = root_;
+    while (slot) {
+      if (SlotDataInfo* info = slot->get(key)) {
+        return info;
+      }
+      slot = slot->next();
+    }
+    return nullptr;
+  }
+  //------------------------------------------------------------------------------------
+  inline void touchI(SlotDataInfo* info) {
+    if (EXTEND_LIFE_ON_ACCESS) {
+      info->accessTime = CLOCK::now();
+    }
   }
   //------------------------------------------------------------------------------------
   inline bool removeI(uint64_t key, MatchFunction func) {
@@ -323,7 +879,7 @@ class ExpSlotList {
       if (slot->remove(key, func)) {
         if (slot->empty()) {
           slot->removeFromChain(root_);
-          delete slot;
+          freeSlot(slot);
         }
         return true;
       }
@@ -332,15 +888,32 @@ class ExpSlotList {
     return false;
   }
   //------------------------------------------------------------------------------------
-  inline size_t checkI(uint32_t ctime, MatchFunction func) {
+  inline size_t removeAllI(uint64_t key, MatchFunction func) {
+    size_t cnt = 0;
+    ExpSlotList::Slot* slot = root_;
+    while (slot) {
+      cnt += slot->removeAll(key, func);
+      if (slot->empty()) {
+        Slot* n = slot->next();
+        slot->removeFromChain(root_);
+        freeSlot(slot);
+        slot = n;
+      } else {
+        slot = slot->next();
+      }
+    }
+    return cnt;
+  }
+  //------------------------------------------------------------------------------------
+  inline size_t checkI(uint32_t ctime, MatchFunction func, uint32_t* maxLag) {
     size_t cnt = 0;
     ExpSlotList::Slot* slot = root_;
     while (slot) {
-      cnt += slot->expireCheck(ctime, func);
+      cnt += slot->expireCheck(ctime, func, maxLag, change_);
       if (slot->empty()) {
         Slot* n = slot->next();
         slot->removeFromChain(root_);
-        delete slot;
+        freeSlot(slot);
         slot = n;
       } else {
         slot = slot->next();
@@ -349,19 +922,29 @@ class ExpSlotList {
     return cnt;
   }
   //------------------------------------------------------------------------------------
-  inline size_t swapI(ExpSlotList::Slot*& out) {
+  inline size_t swapI(ExpSlotList::Slot*& out, size_t& outSlots) {
     size_t outCnt;
     lock_.lock();
-    out = root_;
-    root_ = nullptr;
-    outCnt = count_;
-    count_ = 0;
+    __atomic_store_n(&out, root_, __ATOMIC_RELAXED);
+    __atomic_store_n(&root_, nullptr, __ATOMIC_RELAXED);
+    outCnt = count_.load(std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    outSlots = slots_;
+    slots_ = 0;
     lock_.unlock();
     return outCnt;
   }
 
  public:
   ExpSlotList() = default;
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Exp Slot List object that allocates its slots from the memory
+   * resource
+   *
+   * @param resource
+   */
+  explicit ExpSlotList(std::pmr::memory_resource* resource) : resource_(resource) {}
 
   //------------------------------------------------------------------------------------
   /**
@@ -377,7 +960,10 @@ class ExpSlotList {
    */
   ExpSlotList(ExpSlotList&& obj) {
     lock_.lock();
-    count_ = obj.swapI(root_);
+    resource_ = obj.resource_;
+    capacity_ = obj.capacity_;
+    maxSlots_ = obj.maxSlots_;
+    count_.store(obj.swapI(root_, slots_), std::memory_order_relaxed);
     lock_.unlock();
   };
   //------------------------------------------------------------------------------------
@@ -385,7 +971,12 @@ class ExpSlotList {
    * @brief Destroy the Exp Slot List object
    *
    */
-  ~ExpSlotList() { flush(); }
+  ~ExpSlotList() {
+    // nothing to report or to filter
+    change_ = nullptr;
+    bloom_ = nullptr;
+    flush();
+  }
   //------------------------------------------------------------------------------------
   /**
    * @brief
@@ -399,12 +990,34 @@ class ExpSlotList {
   bool add(uint64_t key, const T& object, uint32_t expTime) {
     lock_.lock();
     if (addI(key, object, expTime)) {
-      count_++;
+      addCountI(1);
     }
     lock_.unlock();
     return true;
   }
   //------------------------------------------------------------------------------------
+  /**
+   * @brief Add a group of objects under one lock acquisition
+   *
+   * @tparam ITEM any type with key, object and expTime members
+   * @param items
+   * @param count
+   * @return size_t number of added objects
+   */
+  template <class ITEM>
+  size_t addGroup(const ITEM* items, size_t count) {
+    size_t cnt = 0;
+    lock_.lock();
+    for (size_t i = 0; i < count; i++) {
+      if (addI(items[i].key, items[i].object, items[i].expTime)) {
+        cnt++;
+        addCountI(1);
+      }
+    }
+    lock_.unlock();
+    return cnt;
+  }
+  //------------------------------------------------------------------------------------
   /**
    * @brief
    *
@@ -418,24 +1031,54 @@ class ExpSlotList {
     lock_.lock();
     res = removeI(key, func);
     if (res) {
-      count_--;
+      addCountI(-1);
+      bloomRemovedI(1);
+      changedI(ExpChangeType::REMOVE, key);
     }
     lock_.unlock();
     return res;
   }
   //------------------------------------------------------------------------------------
+  /**
+   * @brief Check if the key exists without any side effect (the TTL and the reference bit
+   * are not changed)
+   *
+   * @param key
+   * @return true
+   * @return false
+   */
+  bool contains(uint64_t key) {
+    if (!mayContain(key)) {
+      return false;
+    }
+    bool res = false;
+    lock_.lock_shared();
+    for (ExpSlotList::Slot* slot = root_; slot && !res; slot = slot->next()) {
+      res = slot->contains(key);
+    }
+    lock_.unlock_shared();
+    return res;
+  }
+  //------------------------------------------------------------------------------------
   /**
    * @brief Use this function to access the object in the read-only mode
    *
    * @param key
    * @param func
+   * @param probes optional, number of the walked slots
    * @return true
    * @return false
    */
-  bool findR(uint64_t key, MatchFunction func = nullptr) {
+  bool findR(uint64_t key, MatchFunction func = nullptr, uint32_t* probes = nullptr) {
     bool res;
+    if (!mayContain(key)) {
+      if (probes) {
+        *probes = 0;
+      }
+      return false;
+    }
     lock_.lock_shared();
-    res = findI(key, func);
+    res = findI(key, func, probes);
     lock_.unlock_shared();
     return res;
   }
@@ -445,17 +1088,206 @@ class ExpSlotList {
    *
    * @param key
    * @param func
+   * @param probes optional, number of the walked slots
    * @return true
    * @return false
    */
-  bool findW(uint64_t key, MatchFunction func = nullptr) {
+  bool findW(uint64_t key, MatchFunction func = nullptr, uint32_t* probes = nullptr) {
     bool res;
+    if (!mayContain(key)) {
+      if (probes) {
+        *probes = 0;
+      }
+      return false;
+    }
+    lock_.lock();
+    res = findI(key, func, probes);
+    lock_.unlock();
+    return res;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Visit all the objects with the given key (duplicate keys) in one chain walk, in
+   * the read-only mode
+   *
+   * @param key object key
+   * @param func called for each object, returning false stops the visit. nullptr only counts
+   * the objects
+   * @param stopped optional, set to true if func stopped the visit
+   * @return size_t number of visited objects
+   */
+  size_t findAll(uint64_t key, MatchFunction func = nullptr, bool* stopped = nullptr) {
+    size_t cnt = 0;
+    bool stop = false;
+    if (!mayContain(key)) {
+      return 0;
+    }
+    lock_.lock_shared();
+    for (ExpSlotList::Slot* slot = root_; slot && !stop; slot = slot->next()) {
+      cnt += slot->findAll(key, func, stop);
+    }
+    lock_.unlock_shared();
+    if (stopped) {
+      *stopped = stop;
+    }
+    return cnt;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Restart the TTL of the object with the given key, with a new TTL value
+   *
+   * @param key object key
+   * @param expTime new TTL
+   * @return true
+   * @return false if the key doesn't exist
+   */
+  bool touch(uint64_t key, uint32_t expTime) {
+    if (!mayContain(key)) {
+      return false;
+    }
+    lock_.lock();
+    SlotDataInfo* info = getI(key);
+    if (info) {
+      info->accessTime = CLOCK::now();
+      info->lifeTime = expTime;
+      changedI(ExpChangeType::UPDATE, key, &info->value(), expTime);
+    }
+    lock_.unlock();
+    return (info != nullptr);
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Insert the object or replace the existing one, in one lock and one chain walk.
+   * The TTL of an existing object is reset to expTime
+   *
+   * @param key object key
+   * @param object
+   * @param expTime TTL
+   * @return true if a new object was inserted
+   * @return false if an existing object was updated
+   */
+  bool upsert(uint64_t key, const T& object, uint32_t expTime) {
+    bool inserted = false;
+    lock_.lock();
+    if (SlotDataInfo* info = getI(key)) {
+      info->value() = object;
+      info->lifeTime = expTime;
+      info->accessTime = CLOCK::now();
+      changedI(ExpChangeType::UPDATE, key, &object, expTime);
+    } else {
+      insertI(key, object, expTime);
+      addCountI(1);
+      inserted = true;
+    }
+    lock_.unlock();
+    return inserted;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Access the object with the given key, create it by the factory function if it does
+   * not exist. both steps are done under one write lock
+   *
+   * @param key object key
+   * @param factory create the new object
+   * @param expTime TTL of the new object
+   * @param func Allow access to the existing or the new object in read-write mode
+   * @return true if a new object was inserted
+   * @return false
+   */
+  bool findOrInsert(uint64_t key, FactoryFunction factory, uint32_t expTime,
+                    MatchFunction func = nullptr) {
+    bool inserted = false;
+    lock_.lock();
+    SlotDataInfo* info = getI(key);
+    if (info) {
+      touchI(info);
+    } else {
+      // reported after func, with the final object
+      info = insertI(key, factory(), expTime, false);
+      addCountI(1);
+      inserted = true;
+    }
+    if (func) {
+      func(info->value());
+    }
+    if (inserted) {
+      changedI(ExpChangeType::ADD, key, &info->value(), expTime);
+    } else if (func) {
+      changedI(ExpChangeType::UPDATE, key, &info->value(), info->lifeTime);
+    }
+    lock_.unlock();
+    return inserted;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Insert, update or remove the object with the given key under one write lock
+   *
+   * @param key object key
+   * @param func compute function, returning false removes the existing object or skips the
+   * insertion
+   * @param expTime TTL of the new object
+   * @return ComputeResult
+   */
+  ComputeResult compute(uint64_t key, ComputeFunction func, uint32_t expTime) {
+    ComputeResult res = ComputeResult::NONE;
+    ExpSlotList::Slot* slot;
+    SlotDataInfo* info = nullptr;
+
     lock_.lock();
-    res = findI(key, func);
+    for (slot = root_; slot; slot = slot->next()) {
+      if ((info = slot->get(key))) {
+        break;
+      }
+    }
+
+    if (info) {
+      if (func(info->value(), true)) {
+        touchI(info);
+        changedI(ExpChangeType::UPDATE, key, &info->value(), info->lifeTime);
+        res = ComputeResult::UPDATED;
+      } else {
+        slot->remove(key);
+        if (slot->empty()) {
+          slot->removeFromChain(root_);
+          freeSlot(slot);
+        }
+        addCountI(-1);
+        bloomRemovedI(1);
+        changedI(ExpChangeType::REMOVE, key);
+        res = ComputeResult::REMOVED;
+      }
+    } else {
+      T object{};
+      if (func(object, false)) {
+        insertI(key, object, expTime);
+        addCountI(1);
+        res = ComputeResult::INSERTED;
+      }
+    }
     lock_.unlock();
     return res;
   }
   //------------------------------------------------------------------------------------
+  /**
+   * @brief Remove all the objects with the given key that match the predicate
+   *
+   * @param key object key
+   * @param pred predicate, the object is removed if it returns true. nullptr matches all
+   * @return size_t number of removed objects
+   */
+  size_t removeIf(uint64_t key, MatchFunction pred = nullptr) {
+    size_t cnt;
+    lock_.lock();
+    cnt = removeAllI(key, pred);
+    addCountI(-static_cast<ptrdiff_t>(cnt));
+    bloomRemovedI(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+      changedI(ExpChangeType::REMOVE, key);
+    }
+    lock_.unlock();
+    return cnt;
+  }
+  //------------------------------------------------------------------------------------
   /**
    * @brief
    *
@@ -467,11 +1299,19 @@ class ExpSlotList {
     while (slot) {
       ExpSlotList::Slot* temp = slot;
       slot = slot->next();
+      if (change_) {
+        temp->forEachEntry([&](uint64_t key, T&, uint32_t, uint32_t) {
+          changedI(ExpChangeType::REMOVE, key);
+        });
+      }
       temp->forEach(func);
-      delete temp;
+      freeSlot(temp);
+    }
+    __atomic_store_n(&root_, nullptr, __ATOMIC_RELAXED);
+    count_.store(0, std::memory_order_relaxed);
+    if (bloom_) {
+      bloomClearI();
     }
-    root_ = nullptr;
-    count_ = 0;
     lock_.unlock();
   }
   //------------------------------------------------------------------------------------
@@ -494,27 +1334,66 @@ class ExpSlotList {
     return cnt;
   }
   //------------------------------------------------------------------------------------
+  /**
+   * @brief Iterating through all the objects in the list with their keys and TTL informations
+   * in read-only mode
+   *
+   * @param func
+   * @return size_t number of items
+   */
+  size_t dump(EntryFunction func) {
+    size_t cnt = 0;
+    lock_.lock_shared();
+    ExpSlotList::Slot* slot = root_;
+    while (slot) {
+      cnt += slot->forEachEntry(func);
+      slot = slot->next();
+    }
+    lock_.unlock_shared();
+    return cnt;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Add an object with explicit TTL informations (used to restore a dump)
+   *
+   * @param key object key
+   * @param object
+   * @param expTime TTL
+   * @param accessTime last access time
+   */
+  void restore(uint64_t key, const T& object, uint32_t expTime, uint32_t accessTime) {
+    lock_.lock();
+    insertI(key, object, expTime)->accessTime = accessTime;
+    addCountI(1);
+    lock_.unlock();
+  }
+  //------------------------------------------------------------------------------------
   /**
    * @brief
    *
    * @param ctime current time  (relative time)
    * @param matchFunc Remove the expired object from the list, if this function returns true
+   * @param info optional details
    * @return size_t
    */
-  size_t expireCheck(uint32_t ctime, MatchFunction func = nullptr) {
+  size_t expireCheck(uint32_t ctime, MatchFunction func = nullptr, ExpireInfo* info = nullptr) {
     size_t rCount;
 
     // expire check is a low priority functionality.
     if (!lock_.try_lock()) {
+      if (info) {
+        info->lockLost = true;
+      }
       return 0;
     }
 
     if (!ctime) {
-      ctime = libzrvan::utils::Time().getTime();
+      ctime = CLOCK::now();
     }
 
-    rCount = checkI(ctime, func);
-    count_ -= rCount;
+    rCount = checkI(ctime, func, info ? &info->maxLag : nullptr);
+    addCountI(-static_cast<ptrdiff_t>(rCount));
+    bloomRemovedI(rCount);
     lock_.unlock();
     return rCount;
   }
@@ -524,7 +1403,19 @@ class ExpSlotList {
    *
    * @return size_t
    */
-  size_t size() { return count_; }
+  size_t size() const { return count_.load(std::memory_order_relaxed); }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Get the number of the allocated slots (chain length)
+   *
+   * @return size_t
+   */
+  size_t slotsCount() {
+    lock_.lock_shared();
+    size_t cnt = slots_;
+    lock_.unlock_shared();
+    return cnt;
+  }
   //------------------------------------------------------------------------------------
   /**
    * @brief
@@ -539,6 +1430,196 @@ class ExpSlotList {
     }
   }
   //------------------------------------------------------------------------------------
+  /**
+   * @brief Set the memory resource used for the slots allocation (nullptr means new/delete).
+   * It should be called before preLoad or adding any object
+   *
+   * @param resource
+   */
+  void setMemoryResource(std::pmr::memory_resource* resource) {
+    lock_.lock();
+    resource_ = resource;
+    lock_.unlock();
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Get the memory size of one slot
+   *
+   * @return constexpr size_t
+   */
+  static constexpr size_t getSlotSize() { return sizeof(Slot); }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Set the maximum number of objects (0 means unbounded). It is only used if the
+   * EVICTION policy is not NoEviction. With a slots bound, the insertions fill the holes of the
+   * chain instead of allocating a new slot once the bound is reached, so the list never holds
+   * more than maxSlots slots if capacity <= maxSlots * 64
+   *
+   * @param capacity
+   * @param maxSlots maximum number of the slots (0 means unbounded)
+   */
+  void setCapacity(size_t capacity, size_t maxSlots = 0) {
+    lock_.lock();
+    capacity_ = capacity;
+    maxSlots_ = maxSlots;
+    lock_.unlock();
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Get the number of the objects evicted since the last call. Callers that keep their
+   * own objects count use it to account the evictions done by the insertions
+   *
+   * @return size_t
+   */
+  size_t takeEvicted() {
+    if constexpr (EVICTION::type == EvictionType::NONE) {
+      return 0;
+    } else {
+      if (!evicted_.load(std::memory_order_relaxed)) {
+        return 0;
+      }
+      return evicted_.exchange(0, std::memory_order_relaxed);
+    }
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Attach a Bloom filter to the list, it is built from the current objects. The
+   * filter is updated by the insertions and rebuilt lazily after the removals, and findR and
+   * findW check it before taking the lock
+   *
+   * @param blocks filter memory, it must outlive the list (or be detached by passing nullptr)
+   * @param count number of the blocks, power of two
+   */
+  void setBloomFilter(BloomBlock* blocks, uint32_t count) {
+    lock_.lock();
+    bloom_ = blocks;
+    bloomMask_ = blocks ? count - 1 : 0;
+    bloomScratch_.reset(blocks ? new uint64_t[size_t(count) * 8] : nullptr);
+    if (bloom_) {
+      bloomRebuildI();
+    }
+    lock_.unlock();
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Set a function that is called under the lock for each insertion, update (upsert,
+   * compute, touch), removal, expiration and eviction. flush reports a removal per object. The
+   * changes made in place through findW are not reported
+   *
+   * @param change it must outlive the list, nullptr disables it
+   */
+  void setChangeFunction(const ChangeFunction* change) {
+    lock_.lock();
+    change_ = change;
+    lock_.unlock();
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Lock-free negative lookup. It only reads one cache line of the filter
+   *
+   * @param key
+   * @return false if the key is not in the list
+   * @return true if the key may be in the list (or there is no filter)
+   */
+  inline bool mayContain(uint64_t key) const {
+    if (!bloom_) {
+      return true;
+    }
+    uint64_t hash = bloomHash(key);
+    const BloomBlock& block = bloom_[hash & bloomMask_];
+    for (uint32_t i = 0; i < bloomHashes_; i++) {
+      uint32_t bit = (hash >> (28 + i * 9)) & 511;
+      if (!(block.words[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Prefetch the head slot of the list. It is a hint and doesn't take the lock, so
+   * it should be followed by a normal (locked) operation. The root is stored atomically by
+   * the writers and read relaxed here, the slot may be freed meanwhile but a prefetch
+   * doesn't fault
+   *
+   */
+  void prefetch() const {
+    if (ExpSlotList::Slot* slot = __atomic_load_n(&root_, __ATOMIC_RELAXED)) {
+      slot->prefetch();
+    }
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief State of a resumable read-only lookup. Used to interleave several lookups on one
+   * thread, see beginProbe and stepProbe
+   */
+  class Probe {
+    friend class ExpSlotList;
+
+   private:
+    ExpSlotList::Slot* slot_ = nullptr;
+    uint64_t key_ = 0;
+    bool found_ = false;
+
+   public:
+    /**
+     * @brief
+     *
+     * @return true if the key was found
+     * @return false
+     */
+    bool found() const { return found_; }
+  };
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Start a resumable lookup. It never blocks, if the read lock is not available it
+   * returns false and the caller should retry later. On success, the list stays read-locked
+   * until stepProbe returns true
+   *
+   * @param probe
+   * @param key
+   * @return true
+   * @return false
+   */
+  bool beginProbe(Probe& probe, uint64_t key) {
+    if (!lock_.try_lock_shared()) {
+      return false;
+    }
+    probe.key_ = key;
+    probe.found_ = false;
+    probe.slot_ = root_;
+    if (probe.slot_) {
+      probe.slot_->prefetch();
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------
+  /**
+   * @brief Check one slot of a started lookup and prefetch the next one
+   *
+   * @param probe
+   * @param func
+   * @return true if the lookup is finished (and the read lock is released)
+   * @return false
+   */
+  bool stepProbe(Probe& probe, MatchFunction func = nullptr) {
+    ExpSlotList::Slot* slot = probe.slot_;
+    if (slot && slot->find(probe.key_, func)) {
+      probe.found_ = true;
+      slot = nullptr;
+    } else if (slot) {
+      slot = slot->next();
+    }
+
+    probe.slot_ = slot;
+    if (slot) {
+      slot->prefetch();
+      return false;
+    }
+    lock_.unlock_shared();
+    return true;
+  }
+  //------------------------------------------------------------------------------------
 
 };  // namespace ds
 }  // namespace ds
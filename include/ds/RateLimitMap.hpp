@@ -0,0 +1,178 @@
+#pragma once
+
+#include "ExpMap.hpp"
+#include <atomic>
+#include <chrono>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Thread-safe per key rate limiter (token bucket semantic) with the
+ * expiration capability. Each key keeps a GCRA (generic cell rate algorithm)
+ * state, one atomic theoretical arrival time stored inline in the slot, so
+ * consume only takes the segment read lock and updates the state with one
+ * compare and swap. New keys are created under the segment write lock. Idle
+ * keys expire through the ExpMap TTL (the TTL is extended on each access)
+ *
+ * @tparam K key type class
+ * @tparam HASH
+ * @tparam SEGCOUNT hash segment count
+ * @tparam PRELOAD Preloading the hash segments
+ * @tparam LOCK segments lock
+ */
+template <class K, class HASH = utils::FastHash<K>, uint32_t SEGCOUNT = 65536,
+          bool PRELOAD = false, class LOCK = libzrvan::utils::RWSpinLock<>>
+class RateLimitMap {
+private:
+  /**
+   * @brief GCRA state, the time (ns) at which the bucket is full again
+   */
+  struct State {
+    std::atomic<uint64_t> tat = {0};
+    State() = default;
+    State(const State &obj) : tat(obj.tat.load(std::memory_order_relaxed)) {}
+    State &operator=(const State &obj) {
+      tat.store(obj.tat.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+      return *this;
+    }
+  };
+  using Map = ExpMap<K, State, HASH, SEGCOUNT, true, PRELOAD, LOCK>;
+
+  Map map_;
+  // ns per token
+  uint64_t interval_;
+  // ns of the burst
+  uint64_t tolerance_;
+  // seconds
+  uint32_t idleTime_;
+
+  //-------------------------------------------------------------------------------------
+  inline bool consumeI(State &state, uint32_t count, uint64_t now) {
+    uint64_t tat = state.tat.load(std::memory_order_relaxed);
+    while (true) {
+      uint64_t newTat = std::max(tat, now) + count * interval_;
+      if (newTat - now > tolerance_) {
+        return false;
+      }
+      if (state.tat.compare_exchange_weak(tat, newTat,
+                                          std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the current time (ns) of the limiter
+   *
+   * @return uint64_t
+   */
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Rate Limit Map object
+   *
+   * @param rate tokens per second
+   * @param burst bucket size (tokens)
+   * @param idleTime TTL of the idle keys (seconds), 0 means the time to refill
+   * the bucket
+   * @param options see ExpMapOptions
+   */
+  RateLimitMap(uint64_t rate, uint64_t burst, uint32_t idleTime = 0,
+               const ExpMapOptions &options = ExpMapOptions())
+      : map_(options) {
+    interval_ =
+        std::max<uint64_t>(1, 1000000000ULL / std::max<uint64_t>(1, rate));
+    tolerance_ = interval_ * std::max<uint64_t>(1, burst);
+    idleTime_ = idleTime ? idleTime : (tolerance_ / 1000000000ULL) + 1;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Take tokens from the bucket of the key
+   *
+   * @param key
+   * @param count number of the tokens
+   * @param cTime current time (ns, see now), 0 means now
+   * @return true if the tokens were available
+   * @return false
+   */
+  bool consume(const K &key, uint32_t count = 1, uint64_t cTime = 0) {
+    struct {
+      uint64_t time;
+      uint32_t count;
+      bool res;
+    } req = {cTime ? cTime : now(), count, false};
+    // small capture, so the match function doesn't allocate
+    typename Map::MatchFunc func = [this, &req](State &state) {
+      req.res = consumeI(state, req.count, req.time);
+      return true;
+    };
+    if (map_.findR(key, func)) {
+      return req.res;
+    }
+    // new key, the factory and the first consume run under one lock
+    map_.findOrInsert(key, [] { return State(); }, idleTime_, func);
+    return req.res;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the available tokens of the key
+   *
+   * @param key
+   * @param cTime current time (ns, see now), 0 means now
+   * @return uint64_t
+   */
+  uint64_t available(const K &key, uint64_t cTime = 0) {
+    uint64_t tat = 0;
+    if (!cTime) {
+      cTime = now();
+    }
+    map_.findR(key, [&](State &state) {
+      tat = state.tat.load(std::memory_order_relaxed);
+      return true;
+    });
+    uint64_t used = (tat > cTime) ? tat - cTime : 0;
+    return (tolerance_ - std::min(used, tolerance_)) / interval_;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Reset the bucket of the key
+   *
+   * @param key
+   * @return true
+   * @return false
+   */
+  bool remove(const K &key) { return map_.remove(key); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove the idle keys, see ExpMap::expireCheck
+   *
+   * @param cTime
+   * @return size_t
+   */
+  size_t expireCheck(uint32_t cTime) { return map_.expireCheck(cTime); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the TTL of the idle keys (seconds)
+   *
+   * @return uint32_t
+   */
+  uint32_t getIdleTime() const { return idleTime_; }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get availabe keys count
+   *
+   * @return size_t
+   */
+  size_t size() const { return map_.size(); }
+};
+} // namespace ds
+} // namespace libzrvan
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "../utils/CoreHash.hpp"
+#include "../utils/FastHash.hpp"
+#include "../utils/NullLock.hpp"
+#include "../utils/SPSCQueue.hpp"
+#include "ExpMap.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Shared-nothing sharded ExpMap for thread-per-core designs. Each shard
+ * is a private ExpMap with a no-op lock, owned by exactly one thread. The owner
+ * accesses its shard directly (plain memory access). Operations on the keys of
+ * other shards are posted to the owner through lock-free SPSC mailboxes (one
+ * per shard pair) and are applied when the owner calls poll
+ *
+ * Keys are routed to the shards by shardOf. Callers that steer the traffic by
+ * the same function (for example RSS) never need the mailboxes
+ *
+ * Each shard has a mailbox per sender, so there are shardsCount^2 mailboxes
+ * of mailboxSize messages. A message holds a K, a T and a std::function (about
+ * 64 bytes for uint64_t keys and values), so the default size costs ~64KB per
+ * mailbox, 16MB for 16 shards. Size the mailboxes by the expected burst of the
+ * remote operations between two polls
+ *
+ * @tparam K key type class
+ * @tparam T
+ * @tparam SEGCOUNT hash segment count of each shard
+ * @tparam EXTEND_LIFE_ON_ACCESS
+ * @tparam PRELOAD
+ */
+template <class K, class T, class HASH = utils::FastHash<K>,
+          uint32_t SEGCOUNT = 16384, bool EXTEND_LIFE_ON_ACCESS = true,
+          bool PRELOAD = false>
+class ShardedExpMap {
+public:
+  using MapType = ExpMap<K, T, HASH, SEGCOUNT, EXTEND_LIFE_ON_ACCESS, PRELOAD,
+                         libzrvan::utils::NullLock>;
+  using ExecuteFunc = std::function<void(MapType &)>;
+
+private:
+  enum class MessageType : uint8_t { ADD, UPSERT, REMOVE, EXECUTE };
+
+  struct Message {
+    MessageType type;
+    uint32_t expTime;
+    K key;
+    T value;
+    ExecuteFunc func;
+  };
+
+  // the size is set at run time
+  using Mailbox = libzrvan::utils::SPSCQueue<Message, 0>;
+
+  uint32_t shardsCount_;
+  std::vector<std::unique_ptr<MapType>> shards_;
+  // mailboxes_[to * shardsCount_ + from]
+  std::vector<std::unique_ptr<Mailbox>> mailboxes_;
+  HASH hash_;
+
+  //-------------------------------------------------------------------------------------
+  inline bool post(uint32_t from, uint32_t to, const Message &msg) {
+    return mailboxes_[to * shardsCount_ + from]->push(msg);
+  }
+  //-------------------------------------------------------------------------------------
+  inline void apply(MapType &map, Message &msg) {
+    switch (msg.type) {
+    case MessageType::ADD:
+      map.add(msg.key, msg.value, msg.expTime);
+      break;
+    case MessageType::UPSERT:
+      map.upsert(msg.key, msg.value, msg.expTime);
+      break;
+    case MessageType::REMOVE:
+      map.remove(msg.key);
+      break;
+    case MessageType::EXECUTE:
+      msg.func(map);
+      break;
+    }
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Sharded Exp Map object
+   *
+   * @param shardsCount number of shards, usually the number of worker cores
+   * @param mailboxSize messages per mailbox, rounded up to a power of 2 (see
+   * getMailboxBytes)
+   */
+  ShardedExpMap(uint32_t shardsCount, uint32_t mailboxSize = 1024)
+      : shardsCount_(shardsCount) {
+    for (uint32_t i = 0; i < shardsCount_; i++) {
+      shards_.emplace_back(std::make_unique<MapType>());
+    }
+    for (uint32_t i = 0; i < shardsCount_ * shardsCount_; i++) {
+      mailboxes_.emplace_back(std::make_unique<Mailbox>(mailboxSize));
+    }
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Disable copy and move constructor
+   *
+   */
+  ShardedExpMap(const ShardedExpMap &) = delete;
+  ShardedExpMap(ShardedExpMap &&obj) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the owner shard of the key
+   *
+   * @param key
+   * @return uint32_t
+   */
+  uint32_t shardOf(const K &key) const {
+    // use different bits than the segment selection of ExpMap
+    return libzrvan::utils::CoreHash::hash(hash_(key)) % shardsCount_;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Direct access to the shard. It must only be used by the owner
+   * thread
+   *
+   * @param index
+   * @return MapType&
+   */
+  MapType &shard(uint32_t index) { return *shards_[index]; }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add the item. It is applied directly if the caller owns the key,
+   * otherwise it is posted to the owner
+   *
+   * @param from caller shard
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true
+   * @return false if the owner mailbox is full
+   */
+  bool add(uint32_t from, const K &key, const T &value, uint32_t expTime) {
+    uint32_t to = shardOf(key);
+    if (to == from) {
+      return shards_[to]->add(key, value, expTime);
+    }
+    return post(from, to, Message{MessageType::ADD, expTime, key, value, nullptr});
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Insert or update the item. It is applied directly if the caller owns
+   * the key, otherwise it is posted to the owner
+   *
+   * @param from caller shard
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true
+   * @return false if the owner mailbox is full
+   */
+  bool upsert(uint32_t from, const K &key, const T &value, uint32_t expTime) {
+    uint32_t to = shardOf(key);
+    if (to == from) {
+      shards_[to]->upsert(key, value, expTime);
+      return true;
+    }
+    return post(from, to,
+                Message{MessageType::UPSERT, expTime, key, value, nullptr});
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove the item. It is applied directly if the caller owns the key,
+   * otherwise it is posted to the owner
+   *
+   * @param from caller shard
+   * @param key
+   * @return true
+   * @return false if the item not found (local) or the owner mailbox is full
+   */
+  bool remove(uint32_t from, const K &key) {
+    uint32_t to = shardOf(key);
+    if (to == from) {
+      return shards_[to]->remove(key);
+    }
+    return post(from, to, Message{MessageType::REMOVE, 0, key, T(), nullptr});
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run the function on the owner thread of the shard
+   *
+   * @param from caller shard
+   * @param to target shard
+   * @param func
+   * @return true
+   * @return false if the target mailbox is full
+   */
+  bool execute(uint32_t from, uint32_t to, ExecuteFunc func) {
+    if (to == from) {
+      func(*shards_[to]);
+      return true;
+    }
+    return post(from, to, Message{MessageType::EXECUTE, 0, K(), T(), func});
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Apply the pending operations of the other shards. It must only be
+   * called by the owner thread
+   *
+   * @param index shard index
+   * @param maxCount maximum number of the applied operations
+   * @return size_t number of the applied operations
+   */
+  size_t poll(uint32_t index, size_t maxCount = SIZE_MAX) {
+    size_t cnt = 0;
+    Message msg;
+    MapType &map = *shards_[index];
+    for (uint32_t from = 0; from < shardsCount_ && cnt < maxCount; from++) {
+      Mailbox &mailbox = *mailboxes_[index * shardsCount_ + from];
+      while (cnt < maxCount && mailbox.pop(msg)) {
+        apply(map, msg);
+        cnt++;
+      }
+    }
+    return cnt;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the shards count
+   *
+   * @return uint32_t
+   */
+  uint32_t getShardsCount() const { return shardsCount_; }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the memory used by the mailboxes rings
+   *
+   * @return size_t
+   */
+  size_t getMailboxBytes() const {
+    return mailboxes_.size() * mailboxes_[0]->capacity() * sizeof(Message);
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the approximate items count of all the shards
+   *
+   * @return size_t
+   */
+  size_t size() const {
+    size_t total = 0;
+    for (auto &s : shards_) {
+      total += s->size();
+    }
+    return total;
+  }
+};
+} // namespace ds
+} // namespace libzrvan
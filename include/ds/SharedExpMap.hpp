@@ -0,0 +1,705 @@
+#pragma once
+
+#include "../utils/FastHash.hpp"
+#include "../utils/Time.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <immintrin.h>
+#include <pthread.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+
+namespace libzrvan {
+namespace ds {
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Process-shared hash data structure with the expiration capability.
+ * The segments, the slots and the locks live in one shared memory region
+ * (shm_open or memfd), so several processes (for example pre-forked workers)
+ * can use one table. The slots are linked by indexes instead of pointers, so
+ * the region can be mapped at different addresses.
+ *
+ * - The region has a fixed capacity (slotsCount slots of 64 items)
+ * - Writers use a per segment robust process-shared mutex. If a process dies
+ * while holding it, the next locker repairs the segment chain and continues
+ * - findR is optimistic (seqlock). It doesn't take the lock unless it
+ * races with a writer several times. With EXTEND_LIFE_ON_ACCESS a hit stores
+ * the access time with a relaxed atomic store, so the reads stay lock-free
+ * - A lock that can't be recovered (ENOTRECOVERABLE) throws std::system_error
+ * - T must be trivially copyable, and the callbacks of findR get a copy
+ *
+ * @tparam K key type class
+ * @tparam T
+ * @tparam SEGCOUNT hash segment count
+ * @tparam EXTEND_LIFE_ON_ACCESS
+ */
+template <class K, class T, class HASH = utils::FastHash<K>,
+          uint32_t SEGCOUNT = 65536, bool EXTEND_LIFE_ON_ACCESS = true>
+class SharedExpMap {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SharedExpMap needs a trivially copyable value type");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "SharedExpMap needs lock-free 64 bit atomics");
+
+public:
+  using MatchFunc = std::function<bool(T &)>;
+
+private:
+  static constexpr uint32_t maxSlotItems_ = 64;
+  static constexpr uint64_t slotFullFlag_ = 0xffffffffffffffff;
+  static constexpr uint32_t invalidIndex_ = UINT32_MAX;
+  static constexpr uint64_t magic_ = 0x314d48534e56525a; // "ZRVNSHM1"
+  static constexpr uint32_t maxOptimisticRetries_ = 4;
+  static constexpr uint32_t maxOptimisticCandidates_ = 4;
+
+  struct SlotDataInfo {
+    T item;
+    uint32_t accessTime;
+    uint32_t lifeTime;
+  };
+
+  struct Slot {
+    uint64_t keyList[maxSlotItems_];
+    SlotDataInfo itemsList[maxSlotItems_];
+    uint64_t slotMask;
+    uint32_t next;
+    uint32_t prev;
+  };
+
+  struct alignas(64) Segment {
+    pthread_mutex_t lock;
+    std::atomic<uint32_t> version;
+    uint32_t root;
+  };
+
+  struct alignas(64) Header {
+    std::atomic<uint64_t> magic;
+    uint32_t segments;
+    uint32_t slotsCount;
+    uint32_t valueSize;
+    uint32_t freeHead;
+    pthread_mutex_t allocLock;
+    std::atomic<uint64_t> count;
+    std::atomic<uint32_t> checkIndex;
+  };
+
+  Header *header_ = nullptr;
+  Segment *segments_ = nullptr;
+  Slot *slots_ = nullptr;
+  uint32_t slotsCount_ = 0;
+  size_t mapLen_ = 0;
+  int fd_ = -1;
+  HASH hash_;
+
+  //-------------------------------------------------------------------------------------
+  inline uint32_t getSegment(uint64_t key) const { return (key % SEGCOUNT); }
+  //-------------------------------------------------------------------------------------
+  static size_t regionSize(uint32_t slotsCount) {
+    return sizeof(Header) + sizeof(Segment) * SEGCOUNT +
+           sizeof(Slot) * static_cast<size_t>(slotsCount);
+  }
+  //-------------------------------------------------------------------------------------
+  static void initMutex(pthread_mutex_t *mutex) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Initialize a new region (creator only)
+   *
+   */
+  void initRegion(uint32_t slotsCount) {
+    header_->segments = SEGCOUNT;
+    header_->slotsCount = slotsCount;
+    header_->valueSize = sizeof(T);
+    header_->count = 0;
+    header_->checkIndex = 0;
+    initMutex(&header_->allocLock);
+
+    for (uint32_t i = 0; i < SEGCOUNT; i++) {
+      initMutex(&segments_[i].lock);
+      segments_[i].version = 0;
+      segments_[i].root = invalidIndex_;
+    }
+
+    // free list
+    for (uint32_t i = 0; i < slotsCount; i++) {
+      slots_[i].next = (i + 1 < slotsCount) ? i + 1 : invalidIndex_;
+    }
+    header_->freeHead = slotsCount ? 0 : invalidIndex_;
+    header_->magic.store(magic_, std::memory_order_release);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief The owner of the segment lock died inside a write section. Rebuild
+   * the chain back links and cut the chain at the first invalid link. Slots
+   * that were not linked yet are lost
+   *
+   */
+  void repairSegment(Segment &seg) {
+    uint32_t prev = invalidIndex_;
+    uint32_t index = seg.root;
+    uint32_t steps = 0;
+    while (index != invalidIndex_) {
+      if (index >= slotsCount_ || steps++ >= slotsCount_) {
+        if (prev == invalidIndex_) {
+          seg.root = invalidIndex_;
+        } else {
+          slots_[prev].next = invalidIndex_;
+        }
+        break;
+      }
+      slots_[index].prev = prev;
+      prev = index;
+      index = slots_[index].next;
+    }
+
+    // finish the write section
+    if (seg.version.load(std::memory_order_relaxed) & 1) {
+      seg.version.fetch_add(1, std::memory_order_release);
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Check the result of a mutex lock. A dead owner is recovered with
+   * repair, other failures (ENOTRECOVERABLE, EINVAL, ...) mean the region is
+   * unusable and throw std::system_error
+   *
+   * @return bool true if the lock is taken, false if it is busy (trylock)
+   */
+  template <class F>
+  static bool checkLock(int rc, pthread_mutex_t *mutex, F repair) {
+    if (rc == EOWNERDEAD) {
+      repair();
+      rc = pthread_mutex_consistent(mutex);
+      if (rc != 0) {
+        pthread_mutex_unlock(mutex);
+      }
+    }
+    if (rc == EBUSY) {
+      return false;
+    }
+    if (rc != 0) {
+      throw std::system_error(rc, std::generic_category(),
+                              "SharedExpMap lock");
+    }
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  inline void lockSegment(Segment &seg) {
+    checkLock(pthread_mutex_lock(&seg.lock), &seg.lock,
+              [&]() { repairSegment(seg); });
+  }
+  //-------------------------------------------------------------------------------------
+  inline bool tryLockSegment(Segment &seg) {
+    return checkLock(pthread_mutex_trylock(&seg.lock), &seg.lock,
+                     [&]() { repairSegment(seg); });
+  }
+  //-------------------------------------------------------------------------------------
+  inline void unlockSegment(Segment &seg) { pthread_mutex_unlock(&seg.lock); }
+  //-------------------------------------------------------------------------------------
+  // seqlock write section, used by the optimistic readers
+  inline void beginWrite(Segment &seg) {
+    seg.version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  //-------------------------------------------------------------------------------------
+  inline void endWrite(Segment &seg) {
+    seg.version.fetch_add(1, std::memory_order_release);
+  }
+  //-------------------------------------------------------------------------------------
+  inline void lockAlloc() {
+    // free list updates are single stores, so it is consistent after a crash
+    checkLock(pthread_mutex_lock(&header_->allocLock), &header_->allocLock,
+              []() {});
+  }
+  //-------------------------------------------------------------------------------------
+  inline uint32_t allocSlot() {
+    lockAlloc();
+    uint32_t index = header_->freeHead;
+    if (index != invalidIndex_) {
+      header_->freeHead = slots_[index].next;
+    }
+    pthread_mutex_unlock(&header_->allocLock);
+    return index;
+  }
+  //-------------------------------------------------------------------------------------
+  inline void freeSlot(uint32_t index) {
+    lockAlloc();
+    slots_[index].next = header_->freeHead;
+    header_->freeHead = index;
+    pthread_mutex_unlock(&header_->allocLock);
+  }
+  //-------------------------------------------------------------------------------------
+  inline void linkSlot(Segment &seg, uint32_t index) {
+    Slot &slot = slots_[index];
+    slot.slotMask = 0;
+    slot.prev = invalidIndex_;
+    slot.next = seg.root;
+    if (seg.root != invalidIndex_) {
+      slots_[seg.root].prev = index;
+    }
+    seg.root = index;
+  }
+  //-------------------------------------------------------------------------------------
+  inline void unlinkSlot(Segment &seg, uint32_t index) {
+    Slot &slot = slots_[index];
+    if (slot.next != invalidIndex_) {
+      slots_[slot.next].prev = slot.prev;
+    }
+    if (slot.prev != invalidIndex_) {
+      slots_[slot.prev].next = slot.next;
+    }
+    if (seg.root == index) {
+      seg.root = slot.next;
+    }
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Call func for each item of the segment with the key (segment must
+   * be locked). The walk stops when func returns true
+   *
+   */
+  template <class F> inline bool walkI(Segment &seg, uint64_t key, F func) {
+    uint32_t index = seg.root;
+    while (index != invalidIndex_) {
+      Slot &slot = slots_[index];
+      uint32_t next = slot.next;
+      uint64_t mask = slot.slotMask;
+      while (mask) {
+        uint32_t i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (slot.keyList[i] == key && func(index, i)) {
+          return true;
+        }
+      }
+      index = next;
+    }
+    return false;
+  }
+  //-------------------------------------------------------------------------------------
+  inline bool findI(Segment &seg, uint64_t key, MatchFunc &func) {
+    return walkI(seg, key, [&](uint32_t index, uint32_t i) {
+      SlotDataInfo &info = slots_[index].itemsList[i];
+      if (func && !func(info.item)) {
+        return false;
+      }
+      if (EXTEND_LIFE_ON_ACCESS) {
+        __atomic_store_n(&info.accessTime, libzrvan::utils::Time::getTime(),
+                         __ATOMIC_RELAXED);
+      }
+      return true;
+    });
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Optimistic lookup. The matching items are copied and the copies are
+   * used only if the segment version didn't change
+   *
+   * @return int 1 found, 0 not found, -1 retry with the lock
+   */
+  inline int findOptimisticI(Segment &seg, uint64_t key, MatchFunc &func) {
+    T candidates[maxOptimisticCandidates_];
+    uint32_t positions[maxOptimisticCandidates_];
+    uint32_t count = 0;
+    uint32_t version = seg.version.load(std::memory_order_acquire);
+    if (version & 1) {
+      return -1;
+    }
+
+    uint32_t index = seg.root;
+    uint32_t steps = 0;
+    while (index < slotsCount_ && steps++ < slotsCount_) {
+      Slot &slot = slots_[index];
+      uint64_t mask = __atomic_load_n(&slot.slotMask, __ATOMIC_RELAXED);
+      while (mask) {
+        uint32_t i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (__atomic_load_n(&slot.keyList[i], __ATOMIC_RELAXED) != key) {
+          continue;
+        }
+        if (count == maxOptimisticCandidates_) {
+          return -1;
+        }
+        memcpy(&candidates[count], &slot.itemsList[i].item, sizeof(T));
+        positions[count++] = index * maxSlotItems_ + i;
+      }
+      index = __atomic_load_n(&slot.next, __ATOMIC_RELAXED);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seg.version.load(std::memory_order_relaxed) != version) {
+      return -1;
+    }
+
+    for (uint32_t c = 0; c < count; c++) {
+      if (func && !func(candidates[c])) {
+        continue;
+      }
+      // lock-free extension. The bucket may be reused by a writer after the
+      // version check, then the store only moves the new item's access time to
+      // now, at most by the time this reader was stalled
+      if (EXTEND_LIFE_ON_ACCESS &&
+          seg.version.load(std::memory_order_relaxed) == version) {
+        __atomic_store_n(&slots_[positions[c] / maxSlotItems_]
+                              .itemsList[positions[c] % maxSlotItems_]
+                              .accessTime,
+                         libzrvan::utils::Time::getTime(), __ATOMIC_RELAXED);
+      }
+      return 1;
+    }
+    return 0;
+  }
+  //-------------------------------------------------------------------------------------
+  void close() {
+    if (header_) {
+      munmap(header_, mapLen_);
+      header_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  SharedExpMap() = default;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Disable copy and move constructor
+   *
+   */
+  SharedExpMap(const SharedExpMap &) = delete;
+  SharedExpMap(SharedExpMap &&obj) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Unmap the region. The shared memory object itself is kept, see
+   * unlink
+   *
+   */
+  ~SharedExpMap() { close(); }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Create or attach to a shared region. With an empty name an
+   * anonymous memfd region is created, it is shared with the child processes
+   * created by fork after this call. Otherwise the named POSIX shared memory
+   * object is created (by the first process) or attached
+   *
+   * @param name shared memory object name ("/name") or empty
+   * @param slotsCount capacity in slots (ignored when attaching)
+   * @return true
+   * @return false
+   */
+  bool open(const std::string &name, uint32_t slotsCount) {
+    bool creator = false;
+    close();
+
+    if (name.empty()) {
+      fd_ = memfd_create("libzrvan-expmap", 0);
+      creator = true;
+    } else {
+      fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd_ >= 0) {
+        creator = true;
+      } else if (errno == EEXIST) {
+        fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+      }
+    }
+    if (fd_ < 0) {
+      return false;
+    }
+
+    if (creator) {
+      mapLen_ = regionSize(slotsCount);
+      if (ftruncate(fd_, mapLen_) != 0) {
+        close();
+        return false;
+      }
+    } else {
+      // wait for the creator
+      struct stat st = {};
+      bool ready = false;
+      for (uint32_t i = 0; i < 1000 && !ready; i++) {
+        ready = (fstat(fd_, &st) == 0 &&
+                 static_cast<size_t>(st.st_size) >= sizeof(Header));
+        if (!ready) {
+          usleep(1000);
+        }
+      }
+      if (!ready) {
+        close();
+        return false;
+      }
+      mapLen_ = st.st_size;
+    }
+
+    void *mem =
+        mmap(nullptr, mapLen_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mem == MAP_FAILED) {
+      header_ = nullptr;
+      close();
+      return false;
+    }
+    header_ = static_cast<Header *>(mem);
+    segments_ = reinterpret_cast<Segment *>(header_ + 1);
+    slots_ = reinterpret_cast<Slot *>(segments_ + SEGCOUNT);
+
+    if (creator) {
+      slotsCount_ = slotsCount;
+      initRegion(slotsCount);
+      return true;
+    }
+
+    // wait for the initialization and validate the layout
+    for (uint32_t i = 0; i < 1000; i++) {
+      if (header_->magic.load(std::memory_order_acquire) == magic_) {
+        break;
+      }
+      usleep(1000);
+    }
+    slotsCount_ = header_->slotsCount;
+    if (header_->magic.load(std::memory_order_acquire) != magic_ ||
+        header_->segments != SEGCOUNT || header_->valueSize != sizeof(T) ||
+        regionSize(slotsCount_) > mapLen_) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove the named shared memory object
+   *
+   * @param name
+   * @return true
+   * @return false
+   */
+  static bool unlink(const std::string &name) {
+    return (shm_unlink(name.c_str()) == 0);
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @param value
+   * @param expTime
+   * @return true
+   * @return false if there is no free slot
+   */
+  bool add(const K &key, const T &value, uint32_t expTime) {
+    uint64_t keyval = hash_(key);
+    Segment &seg = segments_[getSegment(keyval)];
+
+    lockSegment(seg);
+    uint32_t index = seg.root;
+    if (index == invalidIndex_ || slots_[index].slotMask == slotFullFlag_) {
+      index = allocSlot();
+      if (index == invalidIndex_) {
+        unlockSegment(seg);
+        return false;
+      }
+      beginWrite(seg);
+      linkSlot(seg, index);
+    } else {
+      beginWrite(seg);
+    }
+
+    Slot &slot = slots_[index];
+    uint32_t i = __builtin_ctzll(~slot.slotMask);
+    slot.keyList[i] = keyval;
+    slot.itemsList[i].item = value;
+    slot.itemsList[i].lifeTime = expTime;
+    // the optimistic readers store it without the lock
+    __atomic_store_n(&slot.itemsList[i].accessTime,
+                     libzrvan::utils::Time::getTime(), __ATOMIC_RELAXED);
+    slot.slotMask |= (1ULL << i);
+    endWrite(seg);
+    unlockSegment(seg);
+
+    header_->count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool remove(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Segment &seg = segments_[getSegment(keyval)];
+
+    lockSegment(seg);
+    bool res = walkI(seg, keyval, [&](uint32_t index, uint32_t i) {
+      Slot &slot = slots_[index];
+      if (func && !func(slot.itemsList[i].item)) {
+        return false;
+      }
+      beginWrite(seg);
+      slot.slotMask &= ~(1ULL << i);
+      if (slot.slotMask == 0) {
+        unlinkSlot(seg, index);
+        freeSlot(index);
+      }
+      endWrite(seg);
+      return true;
+    });
+    unlockSegment(seg);
+
+    if (res) {
+      header_->count.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Optimistic read-only lookup. func gets a copy of the stored object
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool findR(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Segment &seg = segments_[getSegment(keyval)];
+
+    for (uint32_t i = 0; i < maxOptimisticRetries_; i++) {
+      int res = findOptimisticI(seg, keyval, func);
+      if (res >= 0) {
+        return res;
+      }
+      _mm_pause();
+    }
+
+    lockSegment(seg);
+    bool res = findI(seg, keyval, func);
+    unlockSegment(seg);
+    return res;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Read-write lookup, func is called under the segment lock
+   *
+   * @param key
+   * @param func
+   * @return true
+   * @return false
+   */
+  bool findW(const K &key, MatchFunc func = nullptr) {
+    uint64_t keyval = hash_(key);
+    Segment &seg = segments_[getSegment(keyval)];
+
+    lockSegment(seg);
+    beginWrite(seg);
+    bool res = findI(seg, keyval, func);
+    endWrite(seg);
+    unlockSegment(seg);
+    return res;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Check the next segment for the expired items
+   *
+   * @param cTime
+   * @param func
+   * @return size_t
+   */
+  size_t expireCheck(uint32_t cTime, MatchFunc func = nullptr) {
+    uint32_t segIndex =
+        header_->checkIndex.fetch_add(1, std::memory_order_relaxed) %
+        SEGCOUNT;
+    Segment &seg = segments_[segIndex];
+    size_t cnt = 0;
+
+    if (!cTime) {
+      cTime = libzrvan::utils::Time::getTime();
+    }
+
+    // expire check is a low priority functionality.
+    if (!tryLockSegment(seg)) {
+      return 0;
+    }
+    beginWrite(seg);
+    uint32_t index = seg.root;
+    while (index != invalidIndex_) {
+      Slot &slot = slots_[index];
+      uint32_t next = slot.next;
+      uint64_t mask = slot.slotMask;
+      while (mask) {
+        uint32_t i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        SlotDataInfo &info = slot.itemsList[i];
+        if (cTime - __atomic_load_n(&info.accessTime, __ATOMIC_RELAXED) >
+                info.lifeTime &&
+            (!func || func(info.item))) {
+          slot.slotMask &= ~(1ULL << i);
+          cnt++;
+        }
+      }
+      if (slot.slotMask == 0) {
+        unlinkSlot(seg, index);
+        freeSlot(index);
+      }
+      index = next;
+    }
+    endWrite(seg);
+    unlockSegment(seg);
+
+    header_->count.fetch_sub(cnt, std::memory_order_relaxed);
+    return cnt;
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the Segments Count object
+   *
+   * @return constexpr uint32_t
+   */
+  constexpr uint32_t getSegmentsCount() const { return SEGCOUNT; }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the capacity in slots
+   *
+   * @return uint32_t
+   */
+  uint32_t getSlotsCount() const { return slotsCount_; }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get availabe items count (approximate after a process crash)
+   *
+   * @return size_t
+   */
+  size_t size() const { return header_->count.load(std::memory_order_relaxed); }
+};
+} // namespace ds
+} // namespace libzrvan
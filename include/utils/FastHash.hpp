@@ -1,7 +1,12 @@
 #pragma once
 
 #include "CoreHash.hpp"
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
 namespace libzrvan {
 namespace utils {
 
@@ -11,6 +16,83 @@ namespace utils {
  */
 class FastHashCore {
 private:
+  static constexpr uint64_t fixedSeed_ = 0xcbf29ce484222325;
+  static constexpr uint64_t fixedM_ = 0x880355f21e6d1965ULL;
+  //-------------------------------------------------------------------------------------
+  static inline uint64_t mixFixed(uint64_t v) {
+    v ^= v >> 23;
+    v *= 0x2127599bf4325c37ULL;
+    v ^= v >> 47;
+    return v;
+  }
+  //-------------------------------------------------------------------------------------
+  static inline uint64_t load64(const uint8_t *buf) {
+    uint64_t v;
+    memcpy(&v, buf, sizeof(v));
+    return v;
+  }
+  //-------------------------------------------------------------------------------------
+  template <std::size_t LEN, std::size_t... I>
+  static inline uint64_t fasthashFixed(const uint8_t *buf,
+                                       std::index_sequence<I...>) {
+    uint64_t h = fixedSeed_ ^ (LEN * fixedM_);
+    ((h = (h ^ mixFixed(load64(buf + I * 8))) * fixedM_), ...);
+    return h;
+  }
+  //-------------------------------------------------------------------------------------
+  static constexpr uint64_t wideSeed_ = 0x9e3779b97f4a7c15ULL;
+  static constexpr uint64_t wideP1_ = 0x9e3779b185ebca87ULL;
+  static constexpr uint64_t wideP2_ = 0xc2b2ae3d27d4eb4fULL;
+  //-------------------------------------------------------------------------------------
+  static inline uint64_t rotl(uint64_t v, uint32_t r) {
+    return (v << r) | (v >> (64 - r));
+  }
+  //-------------------------------------------------------------------------------------
+  static inline uint64_t wideRound(uint64_t acc, uint64_t v) {
+    return rotl(acc + v * wideP2_, 31) * wideP1_;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief 4 independent lanes over the interleaved words. The lane round (as
+   * in xxHash64) has no dependency on the other lanes, so the multiply chains
+   * overlap in the CPU pipeline. The lanes, the remaining words and the tail
+   * bytes are merged into one fasthash chain at the end
+   */
+  static uint64_t fasthashWide(const uint8_t *buf, std::size_t len) {
+    const uint8_t *end = buf + (len & ~std::size_t(31));
+    uint64_t a0 = wideSeed_ + wideP1_ + wideP2_;
+    uint64_t a1 = wideSeed_ + wideP2_;
+    uint64_t a2 = wideSeed_;
+    uint64_t a3 = wideSeed_ - wideP1_;
+
+    for (; buf != end; buf += 32) {
+      a0 = wideRound(a0, load64(buf));
+      a1 = wideRound(a1, load64(buf + 8));
+      a2 = wideRound(a2, load64(buf + 16));
+      a3 = wideRound(a3, load64(buf + 24));
+    }
+
+    // merge the lanes
+    uint64_t h = wideSeed_ ^ (len * fixedM_);
+    h = (h ^ mixFixed(a0)) * fixedM_;
+    h = (h ^ mixFixed(a1)) * fixedM_;
+    h = (h ^ mixFixed(a2)) * fixedM_;
+    h = (h ^ mixFixed(a3)) * fixedM_;
+
+    // remaining words
+    len &= 31;
+    for (; len >= 8; len -= 8, buf += 8) {
+      h = (h ^ mixFixed(load64(buf))) * fixedM_;
+    }
+
+    // tail bytes
+    if (len) {
+      uint64_t v = 0;
+      memcpy(&v, buf, len);
+      h = (h ^ mixFixed(v)) * fixedM_;
+    }
+    return mixFixed(h);
+  }
   //-------------------------------------------------------------------------------------
   template <uint64_t seed>
   static uint64_t fasthash(const uint8_t *buf, std::size_t len) {
@@ -93,18 +175,75 @@ public:
     uint64_t h = fasthash<0x811c9dc5>(buffer, len);
     return (h - (h >> 32));
   }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Fixed size version of hash64, the loop is unrolled at compile time.
+   * The result is the same as hash64
+   *
+   * @tparam LEN Input length, a multiple of 8
+   * @param buffer Input buffer
+   * @return uint64_t
+   */
+  template <std::size_t LEN>
+  static inline uint64_t hash64Fixed(const uint8_t *buffer) {
+    static_assert(LEN && (LEN % 8) == 0, "LEN must be a multiple of 8");
+    return fasthashFixed<LEN>(buffer, std::make_index_sequence<LEN / 8>());
+  }
+  //-------------------------------------------------------------------------------------
+  // minimum input length of the multi-lane path
+  static constexpr std::size_t wideMinLen = 128;
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Multi-lane hash for the long inputs (URLs, payload fingerprints).
+   * hash64 is limited by the latency of its serial multiply chain, this
+   * version runs 4 independent lanes and merges them at the end. Inputs
+   * shorter than wideMinLen use hash64. The results are not compatible with
+   * hash64
+   *
+   * @param buffer Input buffer
+   * @param len Input length
+   * @return uint64_t
+   */
+  static uint64_t hash64Wide(const uint8_t *buffer, std::size_t len) {
+    if (len < wideMinLen) {
+      return hash64(buffer, len);
+    }
+    return fasthashWide(buffer, len);
+  }
 };
 
 //--------------------------------------------------------------------------------------
 /**
- * @brief
+ * @brief Hash of the integral, enum and trivially copyable types. Integral and
+ * enum values (and 8 bytes objects) are mixed by CoreHash, so sequential keys
+ * are spread over the ExpMap segments. Other objects (flow keys for example)
+ * are hashed by their bytes, with unrolled kernels for 16, 32 and 40 bytes.
+ * The objects must not have padding bytes
  *
  * @tparam T
  */
 template <class T> class FastHash {
+  static_assert(std::is_integral_v<T> || std::is_enum_v<T> ||
+                    std::has_unique_object_representations_v<T>,
+                "FastHash needs an integral type or a trivially copyable type "
+                "without padding");
+
 public:
   size_t operator()(const T &in) const {
-    return reinterpret_cast<uint64_t>(in);
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+      return CoreHash::hash(static_cast<uint64_t>(in));
+    } else if constexpr (sizeof(T) == 8) {
+      uint64_t v;
+      memcpy(&v, &in, sizeof(v));
+      return CoreHash::hash(v);
+    } else if constexpr (sizeof(T) == 16 || sizeof(T) == 32 ||
+                         sizeof(T) == 40) {
+      return FastHashCore::hash64Fixed<sizeof(T)>(
+          reinterpret_cast<const uint8_t *>(&in));
+    } else {
+      return FastHashCore::hash64(reinterpret_cast<const uint8_t *>(&in),
+                                  sizeof(T));
+    }
   }
 };
 //--------------------------------------------------------------------------------------
@@ -121,5 +260,19 @@ public:
                                 in.size());
   }
 };
+//--------------------------------------------------------------------------------------
+/**
+ * @brief String hash for the long strings, see FastHashCore::hash64Wide
+ *
+ * @tparam T
+ */
+template <class T> class FastHashWide;
+template <> class FastHashWide<std::string> {
+public:
+  size_t operator()(const std::string &in) const {
+    return FastHashCore::hash64Wide(
+        reinterpret_cast<const uint8_t *>(in.data()), in.size());
+  }
+};
 } // namespace utils
 } // namespace libzrvan
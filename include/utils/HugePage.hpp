@@ -0,0 +1,159 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief Huge page (2MB) memory mapping helpers. It tries MAP_HUGETLB first (reserved huge
+ * pages) and falls back to a 2MB aligned normal mapping advised with MADV_HUGEPAGE
+ * (transparent huge pages)
+ */
+class HugePage {
+ public:
+  static constexpr size_t hugePageSize_ = 2 * 1024 * 1024;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the mapping granularity
+   *
+   * @param hugePages
+   * @return size_t
+   */
+  static size_t pageSize(bool hugePages) {
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return hugePages ? hugePageSize_ : size;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Round the length up to the mapping granularity
+   *
+   * @param len
+   * @param hugePages
+   * @return size_t
+   */
+  static size_t roundUp(size_t len, bool hugePages) {
+    size_t page = pageSize(hugePages);
+    return (len + page - 1) & ~(page - 1);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Map anonymous memory. the length must be rounded by roundUp
+   *
+   * @param len
+   * @param hugePages
+   * @return void* mapped memory or nullptr
+   */
+  static void* map(size_t len, bool hugePages) {
+    void* ptr;
+    if (!hugePages) {
+      ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      return (ptr == MAP_FAILED) ? nullptr : ptr;
+    }
+
+    // reserved huge pages
+    ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+               -1, 0);
+    if (ptr != MAP_FAILED) {
+      return ptr;
+    }
+
+    // transparent huge pages, the range should be 2MB aligned
+    size_t mapLen = len + hugePageSize_;
+    ptr = mmap(nullptr, mapLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t aligned = (start + hugePageSize_ - 1) & ~(hugePageSize_ - 1);
+    if (aligned != start) {
+      munmap(ptr, aligned - start);
+    }
+    if (size_t tail = (start + mapLen) - (aligned + len)) {
+      munmap(reinterpret_cast<void*>(aligned + len), tail);
+    }
+    ptr = reinterpret_cast<void*>(aligned);
+    madvise(ptr, len, MADV_HUGEPAGE);
+    return ptr;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param ptr
+   * @param len
+   */
+  static void unmap(void* ptr, size_t len) { munmap(ptr, len); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the amount of the memory in the range that is backed by huge pages. It reads
+   * /proc/self/smaps, so it is a slow function. The huge pages of a VMA that is larger than the
+   * range are prorated to the overlap
+   *
+   * @param ptr
+   * @param len
+   * @return size_t
+   */
+  static size_t hugeBytes(const void* ptr, size_t len) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t end = begin + len;
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    size_t overlap = 0;
+    size_t vmaLen = 0;
+    size_t total = 0;
+
+    while (std::getline(in, line)) {
+      unsigned long vBegin, vEnd;
+      // mapping header: "start-end perms ..."
+      if (sscanf(line.c_str(), "%lx-%lx ", &vBegin, &vEnd) == 2) {
+        // the kernel may merge the range with its neighbors, so count the overlap
+        uintptr_t oBegin = std::max<uintptr_t>(vBegin, begin);
+        uintptr_t oEnd = std::min<uintptr_t>(vEnd, end);
+        overlap = (oBegin < oEnd) ? oEnd - oBegin : 0;
+        vmaLen = vEnd - vBegin;
+        continue;
+      }
+      if (!overlap) {
+        continue;
+      }
+      std::istringstream fields(line);
+      std::string name;
+      size_t kb = 0;
+      fields >> name >> kb;
+      if (name == "AnonHugePages:" || name == "Private_Hugetlb:" || name == "Shared_Hugetlb:") {
+        // smaps only has the totals of the VMA, prorate them to the overlap
+        total += std::min<size_t>(overlap, double(kb * 1024) * overlap / vmaLen);
+      }
+    }
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Check if the system can back a mapping by huge pages (reserved huge pages or
+   * transparent huge pages that are not disabled)
+   *
+   * @return true
+   * @return false
+   */
+  static bool available() {
+    size_t reserved = 0;
+    std::ifstream("/proc/sys/vm/nr_hugepages") >> reserved;
+    if (reserved) {
+      return true;
+    }
+    std::string thp;
+    std::getline(std::ifstream("/sys/kernel/mm/transparent_hugepage/enabled"), thp);
+    return !thp.empty() && thp.find("[never]") == std::string::npos;
+  }
+
+};
+}  // namespace utils
+}  // namespace libzrvan
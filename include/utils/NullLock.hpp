@@ -0,0 +1,61 @@
+#pragma once
+
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief No-op lock policy. It can be used in place of SpinLock or RWSpinLock when the
+ * protected object is only accessed by one thread (for example a per-core partition in a
+ * shared-nothing design)
+ *
+ */
+class NullLock {
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   */
+  void lock() {}
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   */
+  void unlock() {}
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return true
+   */
+  bool try_lock() { return true; }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   */
+  void lock_shared() {}
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   */
+  void unlock_shared() {}
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return true
+   */
+  bool try_lock_shared() { return true; }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return false
+   */
+  bool locked() { return false; }
+};
+}  // namespace utils
+}  // namespace libzrvan
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include "HugePage.hpp"
+#include "SpinLock.hpp"
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief Minimal NUMA helpers. It uses the raw system calls, so there is no dependency on
+ * libnuma. On single node systems (or if the kernel doesn't support NUMA) all the functions
+ * fall back to the default behavior
+ */
+class Numa {
+ private:
+  static constexpr int mpolPreferred_ = 1;
+  static constexpr uint32_t maxNodes_ = 1024;
+
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the number of the NUMA nodes
+   *
+   * @return uint32_t
+   */
+  static uint32_t nodesCount() {
+    static const uint32_t count = []() -> uint32_t {
+      // format: "0" or "0-1" or "0,2-3"
+      std::ifstream in("/sys/devices/system/node/online");
+      std::string line;
+      if (!std::getline(in, line) || line.empty()) {
+        return 1;
+      }
+      size_t pos = line.find_last_of(",-");
+      uint32_t last = std::stoul(pos == std::string::npos ? line : line.substr(pos + 1));
+      return last + 1;
+    }();
+    return count;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the NUMA node of the calling thread
+   *
+   * @return uint32_t
+   */
+  static uint32_t currentNode() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+      return 0;
+    }
+    return node;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Set the preferred node of a memory range. It should be called before the first
+   * touch of the memory. the range must be page aligned
+   *
+   * @param addr
+   * @param len
+   * @param node
+   * @return true
+   * @return false
+   */
+  static bool bind(void* addr, size_t len, uint32_t node) {
+    unsigned long mask[maxNodes_ / (sizeof(unsigned long) * 8)] = {0};
+    if (node >= maxNodes_ || nodesCount() < 2) {
+      return false;
+    }
+    mask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+    return (syscall(SYS_mbind, addr, len, mpolPreferred_, mask, maxNodes_ + 1, 0) == 0);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return size_t
+   */
+  static size_t pageSize() {
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+  }
+};
+
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Memory resource that allocates page aligned memory from a specific NUMA node,
+ * optionally backed by huge pages. Each allocation is a separate mapping, so it should be
+ * used as the upstream of a pool resource
+ */
+class NumaMemoryResource : public std::pmr::memory_resource {
+ public:
+  /**
+   * @brief Don't bind the memory to any node
+   */
+  static constexpr uint32_t anyNode = UINT32_MAX;
+
+ private:
+  uint32_t node_;
+  bool hugePages_;
+  SpinLock<> lock_;
+  std::map<void*, size_t> mappings_;
+
+ protected:
+  //-------------------------------------------------------------------------------------
+  void* do_allocate(size_t bytes, size_t) override {
+    size_t len = HugePage::roundUp(bytes, hugePages_);
+    void* ptr = HugePage::map(len, hugePages_);
+    if (!ptr) {
+      throw std::bad_alloc();
+    }
+    if (node_ != anyNode) {
+      Numa::bind(ptr, len, node_);
+    }
+    lock_.lock();
+    mappings_[ptr] = len;
+    lock_.unlock();
+    return ptr;
+  }
+  //-------------------------------------------------------------------------------------
+  void do_deallocate(void* ptr, size_t bytes, size_t) override {
+    lock_.lock();
+    mappings_.erase(ptr);
+    lock_.unlock();
+    HugePage::unmap(ptr, HugePage::roundUp(bytes, hugePages_));
+  }
+  //-------------------------------------------------------------------------------------
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Numa Memory Resource object
+   *
+   * @param node NUMA node or anyNode
+   * @param hugePages use huge pages (see HugePage)
+   */
+  NumaMemoryResource(uint32_t node, bool hugePages = false) : node_(node), hugePages_(hugePages) {}
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the amount of the allocated memory
+   *
+   * @return size_t
+   */
+  size_t allocatedBytes() {
+    size_t total = 0;
+    lock_.lock();
+    for (auto& m : mappings_) {
+      total += m.second;
+    }
+    lock_.unlock();
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the amount of the allocated memory that is backed by huge pages (slow)
+   *
+   * @return size_t
+   */
+  size_t hugeBytes() {
+    size_t total = 0;
+    lock_.lock();
+    for (auto& m : mappings_) {
+      total += HugePage::hugeBytes(m.first, m.second);
+    }
+    lock_.unlock();
+    return total;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the node
+   *
+   * @return uint32_t
+   */
+  uint32_t node() const { return node_; }
+};
+}  // namespace utils
+}  // namespace libzrvan
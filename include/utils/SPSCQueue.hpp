@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief Lock-free bounded single-producer single-consumer ring. Exactly one thread may
+ * push and exactly one thread may pop. Producer and consumer indexes live in separate cache
+ * lines and each side keeps a cached copy of the other side index, so in the common case
+ * push and pop don't touch a shared cache line
+ *
+ * @tparam T object type
+ * @tparam SIZE ring size, must be a power of 2. 0 means the size is set by the constructor and
+ * the ring is allocated on the heap
+ */
+template <class T, uint32_t SIZE = 1024>
+class SPSCQueue {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+ private:
+  static constexpr bool dynamic_ = (SIZE == 0);
+  using Storage = std::conditional_t<dynamic_, std::unique_ptr<T[]>, T[SIZE ? SIZE : 1]>;
+
+  // run time size (SIZE == 0)
+  const uint64_t size_;
+
+  // consumer side
+  alignas(64) std::atomic<uint64_t> head_ = {0};
+  uint64_t cachedTail_ = 0;
+
+  // producer side
+  alignas(64) std::atomic<uint64_t> tail_ = {0};
+  uint64_t cachedHead_ = 0;
+
+  alignas(64) Storage items_ = {};
+
+  //-------------------------------------------------------------------------------------
+  inline uint64_t sizeI() const {
+    if constexpr (dynamic_) {
+      return size_;
+    } else {
+      return SIZE;
+    }
+  }
+
+ public:
+  SPSCQueue() : size_(SIZE) {
+    static_assert(!dynamic_, "the size must be set by the constructor");
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a queue with the size set at run time (SIZE must be 0)
+   *
+   * @param size ring size, rounded up to a power of 2
+   */
+  explicit SPSCQueue(uint32_t size) : size_(roundSize(size)) {
+    static_assert(dynamic_, "SIZE must be 0");
+    items_.reset(new T[size_]());
+  }
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue(SPSCQueue&&) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Add an object to the queue (producer only)
+   *
+   * @param obj
+   * @return true
+   * @return false if the queue is full
+   */
+  bool push(const T& obj) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ == sizeI()) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ == sizeI()) {
+        return false;
+      }
+    }
+    items_[tail & (sizeI() - 1)] = obj;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Remove an object from the queue (consumer only)
+   *
+   * @param obj
+   * @return true
+   * @return false if the queue is empty
+   */
+  bool pop(T& obj) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head == cachedTail_) {
+        return false;
+      }
+    }
+    obj = std::move(items_[head & (sizeI() - 1)]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Approximate number of the queued objects
+   *
+   * @return size_t
+   */
+  size_t size() const {
+    return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return true
+   * @return false
+   */
+  bool empty() const { return size() == 0; }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @return uint32_t
+   */
+  uint32_t capacity() const { return sizeI(); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param size
+   * @return uint64_t size rounded up to a power of 2
+   */
+  static uint64_t roundSize(uint32_t size) {
+    uint64_t out = 1;
+    while (out < size) {
+      out <<= 1;
+    }
+    return out;
+  }
+};
+}  // namespace utils
+}  // namespace libzrvan
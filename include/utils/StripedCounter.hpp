@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief Counter split into cache line sized stripes. Each thread updates the stripe of its
+ * thread index, so concurrent writers don't share a cache line (up to STRIPES threads). Unlike
+ * Counter, any number of threads can use it, threads beyond STRIPES share the stripes with
+ * atomic operations. The read is the sum of the stripes, so it is approximate while writers are
+ * active
+ *
+ * @tparam STRIPES number of the stripes
+ */
+template <uint32_t STRIPES = 64>
+class StripedCounter {
+ private:
+  struct alignas(64) Stripe {
+    std::atomic<int64_t> value = {0};
+  };
+
+  static inline std::atomic<uint32_t> nextIndex_ = {0};
+  static inline thread_local uint32_t threadIndex_ = UINT32_MAX;
+
+  Stripe stripes_[STRIPES];
+
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get a unique index of the calling thread (shared by all the StripedCounter
+   * objects)
+   *
+   * @return uint32_t
+   */
+  static uint32_t threadIndex() {
+    if (threadIndex_ == UINT32_MAX) {
+      threadIndex_ = nextIndex_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return threadIndex_;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param val
+   */
+  void add(int64_t val) {
+    stripes_[threadIndex() % STRIPES].value.fetch_add(val, std::memory_order_relaxed);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param val
+   */
+  void sub(int64_t val) { add(-val); }
+  //-------------------------------------------------------------------------------------
+  void operator+=(int64_t val) { add(val); }
+  //-------------------------------------------------------------------------------------
+  void operator-=(int64_t val) { add(-val); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief get the result
+   *
+   * @return int64_t
+   */
+  int64_t get() const {
+    int64_t sum = 0;
+    for (auto& s : stripes_) {
+      sum += s.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Set the counter to zero. It should not race with the writers
+   *
+   */
+  void reset() {
+    for (auto& s : stripes_) {
+      s.value.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+//---------------------------------------------------------------------------------------
+/**
+ * @brief Single writer counter with the StripedCounter interface, for the objects that are
+ * confined to one thread (NullLock). The updates are a relaxed load and store, so there is no
+ * atomic read-modify-write, and other threads can still read an approximate value
+ */
+class PlainCounter {
+ private:
+  std::atomic<int64_t> value_ = {0};
+
+ public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param val
+   */
+  void add(int64_t val) {
+    value_.store(value_.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief
+   *
+   * @param val
+   */
+  void sub(int64_t val) { add(-val); }
+  //-------------------------------------------------------------------------------------
+  void operator+=(int64_t val) { add(val); }
+  //-------------------------------------------------------------------------------------
+  void operator-=(int64_t val) { add(-val); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief get the result
+   *
+   * @return int64_t
+   */
+  int64_t get() const { return value_.load(std::memory_order_relaxed); }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Set the counter to zero
+   *
+   */
+  void reset() { value_.store(0, std::memory_order_relaxed); }
+};
+}  // namespace utils
+}  // namespace libzrvan
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "SpinLock.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace libzrvan {
+namespace utils {
+
+/**
+ * @brief Small work-stealing thread pool. Each worker has its own task deque. A
+ * worker runs its own tasks in LIFO order and, when it is idle, steals the
+ * oldest tasks of the other workers. Tasks submitted from a worker go to its
+ * own deque, other threads spread their tasks round robin
+ *
+ */
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+  using RangeFunction = std::function<void(size_t first, size_t last)>;
+
+private:
+  struct alignas(64) Worker {
+    SpinLock<> lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_ = {false};
+  std::atomic<size_t> pending_ = {0};
+  std::atomic<uint32_t> next_ = {0};
+  std::mutex waitLock_;
+  std::condition_variable waitCond_;
+
+  static inline thread_local ThreadPool *currentPool_ = nullptr;
+  static inline thread_local uint32_t currentIndex_ = 0;
+
+  //-------------------------------------------------------------------------------------
+  bool popTask(uint32_t index, Task &task) {
+    Worker &worker = *workers_[index];
+    worker.lock.lock();
+    bool res = !worker.tasks.empty();
+    if (res) {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    }
+    worker.lock.unlock();
+    return res;
+  }
+  //-------------------------------------------------------------------------------------
+  bool stealTask(uint32_t index, Task &task) {
+    uint32_t count = workers_.size();
+    for (uint32_t i = 1; i <= count; i++) {
+      Worker &worker = *workers_[(index + i) % count];
+      if (!worker.lock.try_lock()) {
+        continue;
+      }
+      bool res = !worker.tasks.empty();
+      if (res) {
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+      }
+      worker.lock.unlock();
+      if (res) {
+        return true;
+      }
+    }
+    return false;
+  }
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run one task, from the worker own deque first
+   *
+   * @param index worker index
+   * @param owner the caller is the worker itself
+   * @return true if a task was executed
+   */
+  bool runOne(uint32_t index, bool owner) {
+    Task task;
+    if ((owner && popTask(index, task)) || stealTask(index, task)) {
+      pending_--;
+      task();
+      return true;
+    }
+    return false;
+  }
+  //-------------------------------------------------------------------------------------
+  void workerFunc(uint32_t index) {
+    currentPool_ = this;
+    currentIndex_ = index;
+    while (true) {
+      if (runOne(index, true)) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lk(waitLock_);
+      waitCond_.wait(lk, [this] { return stop_ || pending_ > 0; });
+      if (stop_ && pending_ == 0) {
+        return;
+      }
+    }
+  }
+
+public:
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Construct a new Thread Pool object
+   *
+   * @param threadsCount number of the workers, 0 means hardware concurrency
+   */
+  explicit ThreadPool(uint32_t threadsCount = 0) {
+    if (!threadsCount) {
+      threadsCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 0; i < threadsCount; i++) {
+      workers_.emplace_back(std::make_unique<Worker>());
+    }
+    for (uint32_t i = 0; i < threadsCount; i++) {
+      threads_.emplace_back(&ThreadPool::workerFunc, this, i);
+    }
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Disable copy and move constructor
+   *
+   */
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Run the remaining tasks and stop the workers
+   *
+   */
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lk(waitLock_);
+      stop_ = true;
+    }
+    waitCond_.notify_all();
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Queue a task
+   *
+   * @param task
+   */
+  void submit(Task task) {
+    uint32_t index = (currentPool_ == this)
+                         ? currentIndex_
+                         : (next_++ % static_cast<uint32_t>(workers_.size()));
+    Worker &worker = *workers_[index];
+    worker.lock.lock();
+    worker.tasks.emplace_back(std::move(task));
+    worker.lock.unlock();
+    pending_++;
+    {
+      std::lock_guard<std::mutex> lk(waitLock_);
+    }
+    waitCond_.notify_one();
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Split [0, count) into chunks and run func on them in parallel. The
+   * calling thread takes part in the work and the call returns when all the
+   * chunks are done. Nested calls from the pool tasks are allowed
+   *
+   * @param count range size
+   * @param func called with [first, last) of each chunk, from several threads
+   * at once
+   * @param parallelism maximum number of the threads that run the chunks, 0
+   * means all the workers and the caller
+   * @param chunk chunk size, 0 means automatic
+   */
+  void parallelFor(size_t count, const RangeFunction &func,
+                   uint32_t parallelism = 0, size_t chunk = 0) {
+    if (!parallelism) {
+      parallelism = getThreadsCount() + 1;
+    }
+    if (!chunk) {
+      chunk = std::max<size_t>(1, count / (size_t(parallelism) * 8));
+    }
+    parallelism = std::min<size_t>(parallelism, (count + chunk - 1) / chunk);
+    if (parallelism <= 1) {
+      if (count) {
+        func(0, count);
+      }
+      return;
+    }
+
+    std::atomic<size_t> nextChunk = {0};
+    std::atomic<uint32_t> remaining = {parallelism};
+    auto runner = [&]() {
+      size_t first;
+      while ((first = nextChunk.fetch_add(chunk)) < count) {
+        func(first, std::min(first + chunk, count));
+      }
+      remaining--;
+    };
+
+    for (uint32_t i = 1; i < parallelism; i++) {
+      submit(runner);
+    }
+    runner();
+
+    // help the other tasks until all the runners are finished
+    bool owner = (currentPool_ == this);
+    while (remaining) {
+      if (!runOne(owner ? currentIndex_ : 0, owner)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  //-------------------------------------------------------------------------------------
+  /**
+   * @brief Get the workers count
+   *
+   * @return uint32_t
+   */
+  uint32_t getThreadsCount() const { return threads_.size(); }
+};
+} // namespace utils
+} // namespace libzrvan
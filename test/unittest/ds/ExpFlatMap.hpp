@@ -0,0 +1,273 @@
+#pragma once
+#include "../../../include/ds/ExpFlatMap.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, exp_flat_map_test) {
+  static constexpr uint32_t testCount = 100000;
+  libzrvan::ds::ExpFlatMap<uint64_t, uint64_t> map(16);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.add(i, i, 10), true);
+  }
+  EXPECT_EQ(map.size(), testCount);
+  EXPECT_GE(map.getCapacity() * 7, testCount * 8);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    uint64_t value = 0;
+    EXPECT_EQ(map.findR(i,
+                        [&](uint64_t &v) {
+                          value = v;
+                          return true;
+                        }),
+              true);
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_EQ(map.findR(testCount), false);
+
+  // update
+  EXPECT_EQ(map.findW(5,
+                      [](uint64_t &v) {
+                        v = 50;
+                        return true;
+                      }),
+            true);
+  EXPECT_EQ(map.findR(5, [](uint64_t &v) { return v == 50; }), true);
+
+  // remove half of the items
+  for (uint64_t i = 0; i < testCount; i += 2) {
+    EXPECT_EQ(map.remove(i), true);
+  }
+  EXPECT_EQ(map.size(), testCount / 2);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), (i % 2) == 1);
+  }
+  EXPECT_EQ(map.forEach(), testCount / 2);
+
+  size_t flushed = 0;
+  map.flush([&](uint64_t &) {
+    flushed++;
+    return true;
+  });
+  EXPECT_EQ(flushed, testCount / 2);
+  EXPECT_EQ(map.size(), 0);
+}
+//---------------------------------------------------------------------------------------
+// random add/remove against std::unordered_multimap, it checks the backward shift
+TEST(ds, exp_flat_map_random_test) {
+  static constexpr uint32_t testCount = 200000;
+  static constexpr uint64_t keyRange = 2048;
+  libzrvan::ds::ExpFlatMap<uint64_t, uint64_t> map(16);
+  std::unordered_multimap<uint64_t, uint64_t> ref;
+  std::mt19937_64 rnd(7);
+
+  for (uint32_t i = 0; i < testCount; i++) {
+    uint64_t key = rnd() % keyRange;
+    if (rnd() % 3) {
+      map.add(key, i, 10);
+      ref.emplace(key, i);
+    } else {
+      auto it = ref.find(key);
+      EXPECT_EQ(map.remove(key), it != ref.end());
+      if (it != ref.end()) {
+        // any duplicate can be removed, remove the same one from the reference
+        ref.erase(it);
+      }
+    }
+  }
+  EXPECT_EQ(map.size(), ref.size());
+  for (uint64_t key = 0; key < keyRange; key++) {
+    size_t count = 0;
+    map.findR(key, [&](uint64_t &) {
+      count++;
+      return false;
+    });
+    EXPECT_EQ(count, ref.count(key));
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_flat_map_expire_test) {
+  static constexpr uint32_t testCount = 10000;
+  libzrvan::ds::ExpFlatMap<uint64_t, uint64_t> map;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, (i % 2) ? 100 : 1);
+  }
+
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 10;
+  size_t removed = 0;
+  // each call checks up to 256 buckets of one shard, make sure every shard gets
+  // a full pass
+  for (size_t i = 0; i < map.getCapacity(); i += 16) {
+    removed += map.expireCheck(cTime);
+  }
+  EXPECT_EQ(removed, testCount / 2);
+  EXPECT_EQ(map.size(), testCount / 2);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), (i % 2) == 1);
+  }
+}
+//---------------------------------------------------------------------------------------
+// writers grow their shards while the readers look up the stable keys
+TEST(ds, exp_flat_map_concurrent_test) {
+  static constexpr uint32_t writersCount = 2;
+  static constexpr uint32_t readersCount = 2;
+  static constexpr uint64_t stableCount = 10000;
+  static constexpr uint64_t writeCount = 50000;
+  libzrvan::ds::ExpFlatMap<uint64_t, uint64_t> map(16);
+  std::atomic<uint64_t> misses{0};
+  std::atomic<bool> done{false};
+
+  for (uint64_t i = 0; i < stableCount; i++) {
+    map.add(i, i, 100);
+  }
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < writersCount; t++) {
+    threads.emplace_back([&, t]() {
+      uint64_t base = stableCount + t * writeCount;
+      for (uint64_t i = base; i < base + writeCount; i++) {
+        map.add(i, i, 100);
+      }
+      for (uint64_t i = base; i < base + writeCount; i += 2) {
+        map.remove(i);
+      }
+    });
+  }
+  for (uint32_t t = 0; t < readersCount; t++) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        for (uint64_t i = 0; i < stableCount; i++) {
+          if (!map.findR(i, [&](uint64_t &v) { return v == i; })) {
+            misses++;
+          }
+        }
+      }
+    });
+  }
+  for (uint32_t t = 0; t < writersCount; t++) {
+    threads[t].join();
+  }
+  done = true;
+  for (uint32_t t = writersCount; t < threads.size(); t++) {
+    threads[t].join();
+  }
+
+  EXPECT_EQ(misses.load(), 0);
+  EXPECT_EQ(map.size(), stableCount + writersCount * writeCount / 2);
+  EXPECT_EQ(map.forEach(), map.size());
+}
+//---------------------------------------------------------------------------------------
+template <class K, uint32_t TCOUNT, class HASH>
+void testExpFlatMap(const std::string &comment) {
+  std::vector<K> testObjects[TCOUNT];
+  libzrvan::ds::ExpFlatMap<K, testObjectMap, HASH> map;
+
+  // fill test objects
+  for (uint32_t i = 0; i < TCOUNT; i++) {
+    fillMapTestObjects<K>(testObjects[i]);
+  }
+
+  auto fillFunc = [&](uint32_t index) {
+    for (auto i : testObjects[index]) {
+      testObjectMap obj;
+      map.add(i, obj, 10);
+    }
+  };
+
+  auto searchFuncRead = [&](uint32_t index) {
+    uint64_t total = 0;
+    for (auto i : testObjects[index]) {
+      if (map.findR(i)) {
+        total++;
+      }
+    }
+
+    if (total != testObjectsCount_) {
+      std::cout << "invalid match count " << total << std::endl;
+    }
+  };
+
+  auto searchFuncWrite = [&](uint32_t index) {
+    uint64_t total = 0;
+    for (auto i : testObjects[index]) {
+      if (map.findW(i)) {
+        total++;
+      }
+    }
+
+    if (total != testObjectsCount_) {
+      std::cout << "invalid match count " << total << std::endl;
+    }
+  };
+
+  runMapTest("test exp flat map insert performance (" + comment + ")",
+             fillFunc, TCOUNT);
+  runMapTest("test exp flat map read performance (" + comment + ")",
+             searchFuncRead, TCOUNT);
+  runMapTest("test exp flat map write performance (" + comment + ")",
+             searchFuncWrite, TCOUNT);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_flat_map_test_performance) {
+#define __TEST_EXP_FLAT_MAP_WITH_T(TCOUNT)                                     \
+  testExpFlatMap<uint64_t, TCOUNT, libzrvan::utils::FastHash<uint64_t>>(       \
+      "uint64-fasthash");                                                      \
+  testExpFlatMap<std::string, TCOUNT,                                          \
+                 libzrvan::utils::FastHash<std::string>>("string-fasthash");   \
+  std::cout << std::endl;
+
+  __TEST_EXP_FLAT_MAP_WITH_T(1)
+  __TEST_EXP_FLAT_MAP_WITH_T(2)
+  __TEST_EXP_FLAT_MAP_WITH_T(4)
+}
+//---------------------------------------------------------------------------------------
+// lookup latency of the readers while a writer grows the table, one shard (a
+// single lock) against the default sharding
+template <uint32_t SEGCOUNT, uint32_t TCOUNT>
+void testExpFlatMapShards(const std::string &comment) {
+  libzrvan::ds::ExpFlatMap<uint64_t, testObjectMap,
+                           libzrvan::utils::FastHash<uint64_t>, SEGCOUNT>
+      map(16);
+  std::vector<uint64_t> testObjects;
+  fillMapTestObjects<uint64_t>(testObjects);
+  for (auto i : testObjects) {
+    map.add(i, testObjectMap(), 10);
+  }
+  std::atomic<uint32_t> running{TCOUNT};
+  std::atomic<uint64_t> worst{0};
+
+  auto func = [&](uint32_t index) {
+    if (index == 0) {
+      // the writer, it keeps adding until the readers are done
+      for (uint64_t i = 1; running.load() > 1; i++) {
+        map.add(i * 0x9e3779b97f4a7c15, testObjectMap(), 10);
+      }
+      return;
+    }
+    uint64_t local = 0;
+    for (auto i : testObjects) {
+      auto start = std::chrono::steady_clock::now();
+      map.findR(i);
+      uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+      local = std::max(local, ns);
+    }
+    uint64_t cur = worst.load();
+    while (local > cur && !worst.compare_exchange_weak(cur, local)) {
+    }
+    running--;
+  };
+
+  runMapTest("test exp flat map read with a writer (" + comment + ")", func,
+             TCOUNT);
+  std::cout << "worst lookup latency " << worst.load() << " ns" << std::endl;
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_flat_map_test_performance_shards) {
+  testExpFlatMapShards<1, 4>("1 shard");
+  testExpFlatMapShards<64, 4>("64 shards");
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "../../../include/ds/ExpMap.hpp"
 #include <chrono>
+#include <memory_resource>
 #include <gtest/gtest.h>
 //---------------------------------------------------------------------------------------
 struct testObjectMap {
@@ -81,6 +82,1075 @@ TEST(ds, exp_map_test) {
   EXPECT_EQ(map.forEach(nullptr), 0);
 }
 
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_upsert_test) {
+  static constexpr uint32_t testCount = 100;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 1024>;
+  MapType map;
+
+  // upsert
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.upsert(i, i, 10), true);
+  }
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.upsert(i, i * 2, 10), false);
+  }
+  EXPECT_EQ(map.size(), testCount);
+  EXPECT_EQ(map.findR(7, [](uint64_t &val) -> bool { return val == 14; }),
+            true);
+
+  // find or insert
+  uint64_t seen = 0;
+  auto factory = []() -> uint64_t { return 1000; };
+  auto access = [&](uint64_t &val) -> bool {
+    seen = val++;
+    return true;
+  };
+  EXPECT_EQ(map.findOrInsert(5, factory, 10, access), false);
+  EXPECT_EQ(seen, 10);
+  EXPECT_EQ(map.findOrInsert(testCount, factory, 10, access), true);
+  EXPECT_EQ(seen, 1000);
+  EXPECT_EQ(map.findR(testCount,
+                      [](uint64_t &val) -> bool { return val == 1001; }),
+            true);
+  EXPECT_EQ(map.size(), testCount + 1);
+
+  // compute
+  auto inc = [](uint64_t &val, bool) -> bool {
+    val++;
+    return true;
+  };
+  auto drop = [](uint64_t &, bool) -> bool { return false; };
+  EXPECT_EQ(map.compute(testCount + 1, inc, 10),
+            MapType::ComputeResult::INSERTED);
+  EXPECT_EQ(map.compute(testCount + 1, inc, 10),
+            MapType::ComputeResult::UPDATED);
+  EXPECT_EQ(map.findR(testCount + 1,
+                      [](uint64_t &val) -> bool { return val == 2; }),
+            true);
+  EXPECT_EQ(map.compute(testCount + 1, drop, 10),
+            MapType::ComputeResult::REMOVED);
+  EXPECT_EQ(map.compute(testCount + 1, drop, 10),
+            MapType::ComputeResult::NONE);
+  EXPECT_EQ(map.size(), testCount + 1);
+
+  // remove if
+  map.add(1, 1, 10);
+  map.add(1, 3, 10);
+  EXPECT_EQ(map.removeIf(1, [](uint64_t &val) -> bool { return val & 1; }),
+            2);
+  EXPECT_EQ(map.findR(1, [](uint64_t &val) -> bool { return val == 2; }),
+            true);
+  EXPECT_EQ(map.removeIf(1), 1);
+  EXPECT_EQ(map.removeIf(1), 0);
+  EXPECT_EQ(map.size(), testCount);
+  EXPECT_EQ(map.forEach(nullptr), testCount);
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_batch_test) {
+  static constexpr uint32_t testCount = 100;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 1024>
+      map;
+  uint64_t keys[testCount];
+  uint64_t values[testCount];
+  bool res[testCount];
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    keys[i] = i * 7;
+    values[i] = i;
+  }
+
+  EXPECT_EQ(map.addBatch(keys, values, testCount, 10), testCount);
+  EXPECT_EQ(map.size(), testCount);
+
+  // all found, values match the keys index
+  EXPECT_EQ(map.findBatch(keys, testCount, res,
+                          [&](size_t index, uint64_t &val) -> bool {
+                            return val == values[index];
+                          }),
+            testCount);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(res[i], true);
+  }
+
+  // remove half of them
+  EXPECT_EQ(map.removeBatch(keys, testCount / 2), testCount / 2);
+  EXPECT_EQ(map.findBatch(keys, testCount, res), testCount / 2);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(res[i], i >= testCount / 2);
+  }
+  EXPECT_EQ(map.removeBatch(keys, testCount, res), testCount / 2);
+  EXPECT_EQ(map.size(), 0);
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_interleaved_find_test) {
+  static constexpr uint32_t testCount = 1000;
+  // few segments, to have long chains
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4>
+      map;
+  std::vector<uint64_t> keys;
+  bool res[testCount * 2];
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 10);
+  }
+  for (uint64_t i = 0; i < testCount * 2; i++) {
+    keys.push_back(i);
+  }
+
+  EXPECT_EQ(map.findInterleaved(keys.data(), keys.size(), res,
+                                [&](size_t index, uint64_t &val) -> bool {
+                                  return val == keys[index];
+                                }),
+            testCount);
+  for (uint64_t i = 0; i < testCount * 2; i++) {
+    EXPECT_EQ(res[i], i < testCount);
+  }
+  EXPECT_EQ(map.findInterleaved<4>(keys.data(), keys.size()), testCount);
+  EXPECT_EQ(map.findInterleaved<1>(keys.data(), 10), 10);
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_numa_test) {
+  static constexpr uint32_t testCount = 10000;
+  libzrvan::ds::ExpMapOptions options;
+  options.numaAware = true;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4096>
+      map(options);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.add(i, i, 10), true);
+    EXPECT_LT(map.getNode(i), libzrvan::utils::Numa::nodesCount());
+  }
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i, [&](uint64_t &val) -> bool { return val == i; }),
+              true);
+  }
+  EXPECT_EQ(map.size(), testCount);
+  for (uint64_t i = 0; i < testCount; i += 2) {
+    EXPECT_EQ(map.remove(i), true);
+  }
+  EXPECT_EQ(map.forEach(nullptr), testCount / 2);
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_huge_page_test) {
+  static constexpr uint32_t testCount = 100000;
+  libzrvan::ds::ExpMapOptions options;
+  options.hugePages = true;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 65536>
+      map(options);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.add(i, i, 10), true);
+  }
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i, [&](uint64_t &val) -> bool { return val == i; }),
+              true);
+  }
+  EXPECT_EQ(map.size(), testCount);
+  size_t huge = map.getHugePageBytes();
+  map.flush();
+  EXPECT_EQ(map.forEach(nullptr), 0);
+  if (!libzrvan::utils::HugePage::available()) {
+    GTEST_SKIP() << "huge pages are not available";
+  }
+  EXPECT_GT(huge, 0);
+}
+
+//---------------------------------------------------------------------------------------
+// memory resource wrapper that counts the allocated bytes
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+  std::pmr::memory_resource *upstream_;
+  size_t allocated_ = 0;
+
+  CountingMemoryResource(std::pmr::memory_resource *upstream)
+      : upstream_(upstream) {}
+
+protected:
+  void *do_allocate(size_t bytes, size_t align) override {
+    allocated_ += bytes;
+    return upstream_->allocate(bytes, align);
+  }
+  void do_deallocate(void *ptr, size_t bytes, size_t align) override {
+    allocated_ -= bytes;
+    upstream_->deallocate(ptr, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+};
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_memory_resource_test) {
+  static constexpr uint32_t testCount = 1000;
+  std::pmr::monotonic_buffer_resource arena;
+  CountingMemoryResource resource(&arena);
+  libzrvan::ds::ExpMapOptions options;
+  options.resource = &resource;
+
+  {
+    libzrvan::ds::ExpMap<uint64_t, std::pmr::string,
+                         libzrvan::utils::FastHash<uint64_t>, 64>
+        map(options);
+    size_t base = resource.allocated_;
+    EXPECT_GT(base, 0);
+
+    // long strings, to bypass the small string optimization
+    std::string value(100, 'a');
+    for (uint64_t i = 0; i < testCount; i++) {
+      EXPECT_EQ(map.add(i, std::pmr::string(value), 10), true);
+    }
+    EXPECT_GT(resource.allocated_, base + testCount * value.size());
+    for (uint64_t i = 0; i < testCount; i++) {
+      EXPECT_EQ(map.findR(i,
+                          [&](std::pmr::string &val) -> bool {
+                            return val == value.c_str() &&
+                                   val.get_allocator().resource() ==
+                                       &resource;
+                          }),
+                true);
+    }
+    EXPECT_EQ(map.size(), testCount);
+  }
+
+  // every thing is returned to the resource
+  EXPECT_EQ(resource.allocated_, 0);
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_snapshot_test) {
+  static constexpr uint32_t testCount = 10000;
+  struct Value {
+    uint64_t p1;
+    uint32_t p2;
+  };
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, Value,
+                           libzrvan::utils::FastHash<uint64_t>, 1024>;
+  std::string path = testing::TempDir() + "exp_map_snapshot.bin";
+
+  {
+    MapType map;
+    for (uint64_t i = 0; i < testCount; i++) {
+      map.add(i, Value{i, static_cast<uint32_t>(i * 2)}, 10 + (i % 2) * 100);
+    }
+    EXPECT_EQ(map.snapshot(path), true);
+  }
+
+  for (uint32_t threads : {1, 4}) {
+    MapType map;
+    EXPECT_EQ(map.load(path, threads), true);
+    EXPECT_EQ(map.size(), testCount);
+    EXPECT_EQ(map.forEach(nullptr), testCount);
+    for (uint64_t i = 0; i < testCount; i++) {
+      EXPECT_EQ(map.findR(i,
+                          [&](Value &val) -> bool {
+                            return val.p1 == i && val.p2 == i * 2;
+                          }),
+                true);
+    }
+
+    // remaining TTLs survive the restart
+    size_t expired = 0;
+    uint32_t cTime = libzrvan::utils::Time::getTime() + 11;
+    for (uint32_t i = 0; i < map.getSegmentsCount(); i++) {
+      expired += map.expireCheck(cTime);
+    }
+    EXPECT_EQ(expired, testCount / 2);
+  }
+
+  // invalid input
+  MapType map;
+  EXPECT_EQ(map.load(path + ".none"), false);
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 1024>
+      otherMap;
+  EXPECT_EQ(otherMap.load(path), false);
+  // the clock units don't match
+  libzrvan::ds::ExpMap<uint64_t, Value, libzrvan::utils::FastHash<uint64_t>,
+                       1024, true, true, libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::NoEviction, libzrvan::ds::NoStats,
+                       libzrvan::ds::MillisClock>
+      millisMap;
+  EXPECT_EQ(millisMap.load(path), false);
+  EXPECT_EQ(millisMap.size(), 0);
+  unlink(path.c_str());
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_scan_test) {
+  static constexpr uint32_t testCount = 10000;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 1024>
+      map;
+  std::vector<uint32_t> seen(testCount * 2, 0);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 10);
+  }
+
+  // inserts and removes between the calls
+  uint64_t cursor = 0;
+  uint32_t calls = 0;
+  uint64_t next = testCount;
+  do {
+    size_t visited = 0;
+    cursor = map.scan(
+        cursor, 100,
+        [&](uint64_t &v) {
+          seen[v]++;
+          return true;
+        },
+        &visited);
+    EXPECT_LE(visited, 200);
+    map.add(next, next, 10);
+    map.remove(next++ - testCount / 2);
+    calls++;
+  } while (cursor);
+
+  EXPECT_GT(calls, 1);
+  // the objects that were in the map for the whole scan are visited once
+  for (uint64_t i = testCount / 2 + calls; i < testCount; i++) {
+    EXPECT_EQ(seen[i], 1);
+  }
+  for (auto count : seen) {
+    EXPECT_LE(count, 1);
+  }
+}
+
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_parallel_test) {
+  static constexpr uint32_t testCount = 100000;
+  libzrvan::utils::ThreadPool pool(4);
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4096>
+      map;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 10 + (i % 2) * 100);
+  }
+
+  std::atomic<uint64_t> sum = {0};
+  EXPECT_EQ(map.forEachParallel(pool,
+                                [&](uint64_t &v) {
+                                  sum += v;
+                                  return true;
+                                }),
+            testCount);
+  EXPECT_EQ(sum, uint64_t(testCount) * (testCount - 1) / 2);
+  EXPECT_EQ(map.forEachParallel(pool, nullptr, 2), testCount);
+
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 11;
+  EXPECT_EQ(map.expireAll(pool, cTime), testCount / 2);
+  EXPECT_EQ(map.size(), testCount / 2);
+
+  std::atomic<uint32_t> flushed = {0};
+  map.flushParallel(pool, [&](uint64_t &) {
+    flushed++;
+    return true;
+  });
+  EXPECT_EQ(flushed, testCount / 2);
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.forEach(nullptr), 0);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_eviction_test) {
+  static constexpr uint32_t testCount = 10000;
+  static constexpr uint32_t hotCount = 32;
+  libzrvan::ds::ExpMapOptions options;
+  options.maxItems = 1024;
+
+  // LRU, hard bound
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 16, true, false,
+                       libzrvan::utils::RWSpinLock<>, libzrvan::ds::LRUEviction>
+      lru(options);
+  EXPECT_EQ(lru.getCapacity(), 1024);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(lru.add(i, i, 100), true);
+    EXPECT_LE(lru.size(), 1024);
+  }
+  EXPECT_EQ(lru.size(), 1024);
+  EXPECT_EQ(lru.forEach(nullptr), 1024);
+
+  // CLOCK, the objects that are accessed again survive a scan
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 16, true, false,
+                       libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::ClockEviction>
+      clock(options);
+  for (uint64_t i = 0; i < hotCount; i++) {
+    clock.add(i, i, 100);
+  }
+  for (uint64_t i = hotCount; i < testCount; i++) {
+    if (i % 64 == 0) {
+      for (uint64_t h = 0; h < hotCount; h++) {
+        EXPECT_EQ(clock.findR(h), true);
+      }
+    }
+    clock.add(i, i, 100);
+  }
+  EXPECT_EQ(clock.size(), 1024);
+  EXPECT_EQ(clock.forEach(nullptr), 1024);
+  for (uint64_t h = 0; h < hotCount; h++) {
+    EXPECT_EQ(clock.findR(h), true);
+  }
+
+  // bytes bound
+  libzrvan::ds::ExpMapOptions bytesOptions;
+  bytesOptions.maxBytes = 1 << 20;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 16, true, false,
+                       libzrvan::utils::RWSpinLock<>, libzrvan::ds::LRUEviction>
+      bytes(bytesOptions);
+  EXPECT_GT(bytes.getCapacity(), 0);
+  for (uint64_t i = 0; i < testCount * 10; i++) {
+    bytes.add(i, i, 100);
+  }
+  EXPECT_EQ(bytes.size(), bytes.getCapacity());
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_capacity_test) {
+  static constexpr uint32_t segments = 1024;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, segments, true,
+                           false, libzrvan::utils::RWSpinLock<>,
+                           libzrvan::ds::LRUEviction>;
+
+  // the bound can't be split between the segments
+  libzrvan::ds::ExpMapOptions small;
+  small.maxItems = segments / 2;
+  EXPECT_THROW(MapType map(small), std::invalid_argument);
+  libzrvan::ds::ExpMapOptions smallBytes;
+  smallBytes.maxBytes = 64 * segments;
+  EXPECT_THROW(MapType map(smallBytes), std::invalid_argument);
+
+  // the effective bound is rounded down
+  libzrvan::ds::ExpMapOptions options;
+  options.maxItems = segments * 3 + 100;
+  MapType map(options);
+  EXPECT_EQ(map.getCapacity(), segments * 3);
+  for (uint64_t i = 0; i < segments * 16; i++) {
+    map.add(i, i, 100);
+    EXPECT_LE(map.size(), map.getCapacity());
+  }
+
+  // the bytes bound holds with fragmented slots
+  libzrvan::ds::ExpMapOptions bytesOptions;
+  bytesOptions.maxBytes = 4 << 20;
+  MapType bytes(bytesOptions);
+  for (uint64_t i = 0; i < segments * 1024; i++) {
+    bytes.add(i, i, 100);
+    if (i % 3) {
+      bytes.remove(i);
+    }
+  }
+  EXPECT_LE(bytes.size(), bytes.getCapacity());
+  EXPECT_LE(bytes.stats().bytes, bytesOptions.maxBytes);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_stats_test) {
+  static constexpr uint32_t testCount = 1000;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4, true, false,
+                       libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::NoEviction, libzrvan::ds::ExpMapStats>
+      map;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 10);
+  }
+  for (uint64_t i = 0; i < testCount * 2; i++) {
+    map.findR(i);
+  }
+
+  auto stats = map.stats();
+  EXPECT_EQ(stats.items, testCount);
+  EXPECT_GE(stats.slots, testCount / 64);
+  EXPECT_GT(stats.fillRatio, 0.5);
+  EXPECT_LE(stats.fillRatio, 1.0);
+  EXPECT_GT(stats.bytes, stats.slots * 64 * sizeof(uint64_t));
+  EXPECT_EQ(stats.hotSegments.size(), 4);
+  EXPECT_GE(stats.hotSegments[0].second, stats.hotSegments[3].second);
+  EXPECT_EQ(stats.finds, testCount * 2);
+  EXPECT_EQ(stats.findHits, testCount);
+  uint64_t probes = 0;
+  for (auto p : stats.probeHistogram) {
+    probes += p;
+  }
+  EXPECT_EQ(probes, testCount * 2);
+  EXPECT_GT(stats.maxChainLength, 1);
+
+  // expire check
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 20;
+  for (uint32_t i = 0; i < map.getSegmentsCount(); i++) {
+    map.expireCheck(cTime);
+  }
+  stats = map.stats();
+  EXPECT_EQ(stats.expireChecks, 4);
+  EXPECT_EQ(stats.expired, testCount);
+  EXPECT_EQ(stats.expireLockLost, 0);
+  // lag is about 10 seconds
+  EXPECT_EQ(
+      stats.expireLagHistogram[libzrvan::ds::ExpMapStatsSnapshot::bucket(10)],
+      4);
+  EXPECT_EQ(stats.items, 0);
+
+  // default policy, structure only
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4>
+      plain;
+  plain.add(1, 1, 10);
+  plain.findR(1);
+  EXPECT_EQ(plain.stats().items, 1);
+  EXPECT_EQ(plain.stats().finds, 0);
+}
+//---------------------------------------------------------------------------------------
+// the counters accept any number of threads
+TEST(ds, exp_map_stats_threads_test) {
+  static constexpr uint32_t threadsCount = 1024;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 4, true, false,
+                       libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::NoEviction, libzrvan::ds::ExpMapStats>
+      map;
+  map.add(1, 1, 10);
+  for (uint32_t i = 0; i < threadsCount; i++) {
+    std::thread([&] { map.findR(1); }).join();
+  }
+  auto stats = map.stats();
+  EXPECT_EQ(stats.finds, threadsCount);
+  EXPECT_EQ(stats.findHits, threadsCount);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_size_test) {
+  static constexpr uint32_t testCount = 10000;
+  static constexpr uint32_t threadsCount = 8;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                       libzrvan::utils::FastHash<uint64_t>, 1024>
+      map;
+  std::vector<std::thread> threads;
+
+  for (uint32_t t = 0; t < threadsCount; t++) {
+    threads.emplace_back([&, t]() {
+      for (uint64_t i = 0; i < testCount; i++) {
+        map.add(t * testCount + i, i, 10);
+      }
+      for (uint64_t i = 0; i < testCount; i += 2) {
+        map.remove(t * testCount + i);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(map.size(), threadsCount * testCount / 2);
+  EXPECT_EQ(map.exactSize(), threadsCount * testCount / 2);
+
+  // exactSize doesn't lock, so it can run in a forEach callback while a
+  // writer waits for the segment lock
+  std::atomic<bool> done = {false};
+  std::thread writer([&]() {
+    for (uint64_t i = 0; !done.load(); i++) {
+      map.findW(i % testCount);
+    }
+  });
+  size_t visited = map.forEach([&](uint64_t &) {
+    EXPECT_GE(map.exactSize(), threadsCount * testCount / 2);
+    return true;
+  });
+  done = true;
+  writer.join();
+  EXPECT_EQ(visited, threadsCount * testCount / 2);
+
+  // per-thread expire cursors cover all the segments
+  threads.clear();
+  std::atomic<size_t> expired = {0};
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 11;
+  for (uint32_t t = 0; t < 4; t++) {
+    threads.emplace_back([&]() {
+      for (uint32_t i = 0; i < map.getSegmentsCount(); i++) {
+        expired += map.expireCheck(cTime);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (uint32_t i = 0; i < map.getSegmentsCount(); i++) {
+    expired += map.expireCheck(cTime);
+  }
+  EXPECT_EQ(expired, threadsCount * testCount / 2);
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.exactSize(), 0);
+}
+//---------------------------------------------------------------------------------------
+// identity hash, to build the adversarial keys
+struct ExpMapIdentityHash {
+  size_t operator()(const uint64_t &in) const { return in; }
+};
+TEST(ds, exp_map_two_choice_test) {
+  static constexpr uint32_t testCount = 64 * 64;
+  using MapType = libzrvan::ds::ExpMap<uint64_t, uint64_t, ExpMapIdentityHash,
+                                       64, true, false>;
+  libzrvan::ds::ExpMapOptions options;
+  options.twoChoice = true;
+  MapType single;
+  MapType map(options);
+  std::vector<uint64_t> keys;
+  std::vector<uint64_t> values;
+  bool res[testCount];
+
+  // adversarial keys, all of them have the same first segment
+  for (uint64_t i = 0; i < testCount; i++) {
+    keys.push_back(i * 64);
+    values.push_back(i * 3);
+    single.add(keys[i], i, 10);
+  }
+  EXPECT_EQ(map.addBatch(keys.data(), values.data(), testCount / 2, 10),
+            testCount / 2);
+  for (uint64_t i = testCount / 2; i < testCount; i++) {
+    EXPECT_EQ(map.add(keys[i], i * 3, 10), true);
+  }
+
+  // the most loaded segment is much less loaded
+  EXPECT_EQ(single.stats().hotSegments[0].second, testCount);
+  EXPECT_LT(map.stats().hotSegments[0].second, testCount / 2);
+
+  // lookups check both candidates
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(keys[i], [&](uint64_t &v) { return v == i * 3; }),
+              true);
+  }
+  EXPECT_EQ(map.findBatch(keys.data(), testCount, res), testCount);
+  EXPECT_EQ(map.findInterleaved(keys.data(), testCount), testCount);
+
+  // read-modify-write updates the existing object
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.upsert(keys[i], i, 10), false);
+  }
+  EXPECT_EQ(map.upsert(1, 1, 10), true);
+  EXPECT_EQ(map.exactSize(), testCount + 1);
+  EXPECT_EQ(map.removeIf(1), 1);
+
+  // remove
+  EXPECT_EQ(map.removeBatch(keys.data(), testCount / 2), testCount / 2);
+  for (uint64_t i = testCount / 2; i < testCount; i++) {
+    EXPECT_EQ(map.remove(keys[i]), true);
+  }
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.exactSize(), 0);
+}
+//---------------------------------------------------------------------------------------
+// the read-modify-write insertions are balanced too
+TEST(ds, exp_map_two_choice_upsert_test) {
+  static constexpr uint32_t testCount = 64 * 64;
+  static constexpr uint32_t threadsCount = 4;
+  using MapType = libzrvan::ds::ExpMap<uint64_t, uint64_t, ExpMapIdentityHash,
+                                       64, true, false>;
+  libzrvan::ds::ExpMapOptions options;
+  options.twoChoice = true;
+  MapType map(options);
+
+  // adversarial keys, all of them have the same first segment
+  for (uint64_t i = 0; i < testCount; i++) {
+    if (i % 3 == 0) {
+      EXPECT_EQ(map.upsert(i * 64, i, 10), true);
+    } else if (i % 3 == 1) {
+      EXPECT_EQ(map.findOrInsert(i * 64, [&] { return i; }, 10), true);
+    } else {
+      EXPECT_EQ(map.compute(i * 64, [](uint64_t &, bool) { return true; }, 10),
+                MapType::ComputeResult::INSERTED);
+    }
+  }
+  EXPECT_LT(map.stats().hotSegments[0].second, testCount / 2);
+  EXPECT_EQ(map.exactSize(), testCount);
+
+  // concurrent updates of the same keys don't duplicate them
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < threadsCount; t++) {
+    threads.emplace_back([&, t] {
+      for (uint64_t i = 0; i < testCount; i++) {
+        map.upsert((testCount + i) * 64, t, 10);
+        map.upsert(i * 64, t, 10);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(map.exactSize(), testCount * 2);
+  EXPECT_EQ(map.forEach(nullptr), testCount * 2);
+  for (uint64_t i = 0; i < testCount * 2; i++) {
+    EXPECT_EQ(map.count(i * 64), 1);
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_bloom_test) {
+  static constexpr uint64_t testCount = 1000;
+  static constexpr uint64_t missCount = 10000;
+  libzrvan::ds::ExpMapOptions options;
+  options.bloomBlocks = 1;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       64, true, true, libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::NoEviction, libzrvan::ds::ExpMapStats>
+      map(options);
+  std::vector<uint64_t> keys;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    keys.push_back(i);
+    map.add(i, i, (i % 2) ? 100 : 1);
+  }
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), true);
+  }
+  EXPECT_EQ(map.findInterleaved(keys.data(), testCount), testCount);
+
+  // almost all the misses are answered by the filters without a chain walk
+  for (uint64_t i = testCount; i < testCount + missCount; i++) {
+    EXPECT_EQ(map.findR(i), false);
+  }
+  auto stats = map.stats();
+  EXPECT_EQ(stats.finds, testCount + missCount);
+  EXPECT_GT(stats.probeHistogram[0], missCount * 99 / 100);
+
+  // the filters are rebuilt after the removals
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 10;
+  for (uint32_t i = 0; i < 64; i++) {
+    map.expireCheck(cTime);
+  }
+  for (uint64_t i = 1; i < testCount; i += 2) {
+    EXPECT_EQ(map.remove(i), true);
+  }
+  EXPECT_EQ(map.size(), 0);
+  uint64_t filtered = map.stats().probeHistogram[0];
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), false);
+  }
+  EXPECT_EQ(map.stats().probeHistogram[0], filtered + testCount);
+  EXPECT_EQ(map.findInterleaved(keys.data(), testCount), 0);
+}
+//---------------------------------------------------------------------------------------
+// the rebuilds never hide the existing keys from the lock-free readers
+TEST(ds, exp_map_bloom_rebuild_test) {
+  static constexpr uint64_t testCount = 1000;
+  libzrvan::ds::ExpMapOptions options;
+  options.bloomBlocks = 1;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       16>
+      map(options);
+  std::atomic<bool> stop = {false};
+  std::atomic<uint64_t> missed = {0};
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 100);
+  }
+
+  std::thread writer([&]() {
+    for (uint32_t round = 0; round < 50; round++) {
+      for (uint64_t i = testCount; i < testCount * 3; i++) {
+        map.add(i, i, 100);
+      }
+      for (uint64_t i = testCount; i < testCount * 3; i++) {
+        map.remove(i);
+      }
+    }
+    stop = true;
+  });
+  std::thread reader([&]() {
+    while (!stop) {
+      for (uint64_t i = 0; i < testCount; i++) {
+        if (!map.findR(i)) {
+          missed++;
+        }
+      }
+    }
+  });
+  writer.join();
+  reader.join();
+  EXPECT_EQ(missed, 0);
+  EXPECT_EQ(map.size(), testCount);
+
+  // flush clears the filters, the new objects are found again
+  map.flush();
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), false);
+  }
+  map.add(1, 1, 100);
+  EXPECT_EQ(map.findR(1), true);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_millis_test) {
+  static constexpr uint64_t testCount = 1000;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       16, false, true, libzrvan::utils::RWSpinLock<>,
+                       libzrvan::ds::NoEviction, libzrvan::ds::NoStats,
+                       libzrvan::ds::MillisClock>
+      map;
+
+  // sub-second TTLs
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, (i % 2) ? 60000 : 50);
+  }
+  uint32_t cTime = libzrvan::ds::MillisClock::now();
+  size_t removed = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    removed += map.expireCheck(cTime);
+  }
+  EXPECT_EQ(removed, 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(120));
+  for (uint32_t i = 0; i < 16; i++) {
+    removed += map.expireCheck(0);
+  }
+  EXPECT_EQ(removed, testCount / 2);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), (i % 2) == 1);
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_touch_test) {
+  static constexpr uint64_t testCount = 1000;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       16, false>
+      map;
+  auto expireAll = [&](uint32_t cTime) {
+    size_t removed = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+      removed += map.expireCheck(cTime);
+    }
+    return removed;
+  };
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    map.add(i, i, 1);
+  }
+  EXPECT_EQ(map.touch(testCount, 100), false);
+  EXPECT_EQ(map.expireAt(testCount, 100), false);
+
+  // extend the even keys
+  uint32_t now = libzrvan::ds::SecondsClock::now();
+  for (uint64_t i = 0; i < testCount; i += 2) {
+    EXPECT_EQ(map.touch(i, 100), true);
+  }
+  EXPECT_EQ(expireAll(now + 10), testCount / 2);
+  EXPECT_EQ(map.size(), testCount / 2);
+
+  // absolute deadlines
+  for (uint64_t i = 0; i < testCount; i += 2) {
+    EXPECT_EQ(map.expireAt(i, now + ((i % 4) ? 5 : 50)), true);
+  }
+  EXPECT_EQ(expireAll(now + 10), testCount / 4);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i), (i % 4) == 0);
+  }
+
+  // a passed deadline expires on the next check
+  EXPECT_EQ(map.expireAt(0, now - 10), true);
+  EXPECT_EQ(expireAll(now + 5), 1);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_change_feed_test) {
+  static constexpr uint64_t testCount = 10000;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 64>;
+  MapType::ChangeFeed feed;
+  MapType primary;
+  MapType standby;
+  primary.setChangeFeed(&feed);
+
+  auto sync = [&]() {
+    return feed.drain(
+        [&](const MapType::Change &change) { standby.applyChange(change); });
+  };
+  auto check = [&]() {
+    EXPECT_EQ(standby.size(), primary.size());
+    for (uint64_t i = 0; i < testCount; i++) {
+      uint64_t pv = UINT64_MAX;
+      uint64_t sv = UINT64_MAX;
+      primary.findR(i, [&](uint64_t &v) {
+        pv = v;
+        return true;
+      });
+      standby.findR(i, [&](uint64_t &v) {
+        sv = v;
+        return true;
+      });
+      EXPECT_EQ(pv, sv);
+    }
+  };
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    primary.add(i, i, (i % 4) ? 100 : 1);
+  }
+  EXPECT_EQ(feed.pending(), testCount);
+  EXPECT_EQ(sync(), testCount);
+  EXPECT_EQ(feed.pending(), 0);
+  check();
+
+  // updates, removals and expirations
+  for (uint64_t i = 1; i < testCount; i += 4) {
+    primary.upsert(i, i * 2, 100);
+  }
+  for (uint64_t i = 2; i < testCount; i += 4) {
+    primary.remove(i);
+  }
+  primary.compute(3, [](uint64_t &, bool) { return false; }, 10);
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 10;
+  for (uint32_t i = 0; i < 64; i++) {
+    primary.expireCheck(cTime);
+  }
+  sync();
+  check();
+  EXPECT_EQ(standby.size(), testCount / 2 - 1);
+
+  // flush is reported per object
+  primary.flush();
+  sync();
+  EXPECT_EQ(standby.size(), 0);
+  EXPECT_EQ(feed.takeOverflow(), false);
+
+  // detached
+  primary.setChangeFeed(nullptr);
+  primary.add(1, 1, 10);
+  EXPECT_EQ(feed.pending(), 0);
+}
+//---------------------------------------------------------------------------------------
+// findOrInsert reports the object left by func
+TEST(ds, exp_map_change_feed_find_or_insert_test) {
+  static constexpr uint64_t testCount = 1000;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 64>;
+  MapType::ChangeFeed feed;
+  MapType primary;
+  MapType standby;
+  primary.setChangeFeed(&feed);
+
+  auto incFunc = [](uint64_t &v) {
+    v += 42;
+    return true;
+  };
+  for (uint64_t i = 0; i < testCount; i++) {
+    // new key, then existing key
+    primary.findOrInsert(i, [&] { return i; }, 100, incFunc);
+    primary.findOrInsert(i, [&] { return uint64_t(0); }, 100, incFunc);
+    // an access only
+    primary.findOrInsert(i, [&] { return uint64_t(0); }, 100);
+  }
+  EXPECT_EQ(feed.pending(), testCount * 2);
+  feed.drain(
+      [&](const MapType::Change &change) { standby.applyChange(change); });
+
+  EXPECT_EQ(standby.size(), testCount);
+  for (uint64_t i = 0; i < testCount; i++) {
+    uint64_t sv = 0;
+    standby.findR(i, [&](uint64_t &v) {
+      sv = v;
+      return true;
+    });
+    EXPECT_EQ(sv, i + 84);
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_change_feed_pipe_test) {
+  static constexpr uint64_t testCount = 1000;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 64>;
+  MapType::ChangeFeed feed(128);
+  MapType primary;
+  MapType standby;
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  primary.setChangeFeed(&feed);
+
+  std::thread reader([&]() {
+    MapType::Change change;
+    while (MapType::ChangeFeed::read(fds[0], change)) {
+      standby.applyChange(change);
+    }
+  });
+  for (uint64_t i = 0; i < testCount; i++) {
+    primary.add(i, i, 100);
+    if (i % 2) {
+      primary.remove(i);
+    }
+    feed.drain([&](const MapType::Change &change) {
+      EXPECT_EQ(MapType::ChangeFeed::write(fds[1], change), true);
+    });
+  }
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+  EXPECT_EQ(feed.takeOverflow(), false);
+  EXPECT_EQ(standby.size(), testCount / 2);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(standby.findR(i), (i % 2) == 0);
+  }
+
+  // overflow
+  for (uint64_t i = 0; i < testCount * 64; i++) {
+    primary.add(i, i, 100);
+  }
+  EXPECT_EQ(feed.takeOverflow(), true);
+  EXPECT_EQ(feed.takeOverflow(), false);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_find_all_test) {
+  static constexpr uint64_t keysCount = 100;
+  static constexpr uint64_t dupCount = 150;
+  libzrvan::ds::ExpMapOptions options;
+  options.twoChoice = true;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       16>
+      map(options);
+
+  // duplicates spread over several slots and both candidate segments
+  for (uint64_t d = 0; d < dupCount; d++) {
+    for (uint64_t i = 0; i < keysCount; i++) {
+      map.add(i, i * 1000 + d, 10);
+    }
+  }
+
+  for (uint64_t i = 0; i < keysCount; i++) {
+    EXPECT_EQ(map.count(i), dupCount);
+    std::vector<bool> seen(dupCount, false);
+    size_t visited = map.findAll(i, [&](uint64_t &v) {
+      EXPECT_EQ(v / 1000, i);
+      seen[v % 1000] = true;
+      return true;
+    });
+    EXPECT_EQ(visited, dupCount);
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), true), dupCount);
+  }
+  EXPECT_EQ(map.count(keysCount), 0);
+  EXPECT_EQ(map.findAll(keysCount, [](uint64_t &) { return true; }), 0);
+
+  // early stop
+  size_t calls = 0;
+  EXPECT_EQ(map.findAll(1,
+                        [&](uint64_t &) {
+                          calls++;
+                          return calls < 10;
+                        }),
+            10);
+  EXPECT_EQ(calls, 10);
+
+  EXPECT_EQ(map.removeIf(1), dupCount);
+  EXPECT_EQ(map.count(1), 0);
+}
 //---------------------------------------------------------------------------------------
 static void runMapTest(const std::string &info,
                        std::function<void(uint32_t tid)> func,
@@ -0,0 +1,77 @@
+#pragma once
+#include "../../../include/ds/ExpMap.hpp"
+#include "../../../include/ds/ExpMapInsertBuffer.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, exp_map_insert_buffer_test) {
+  static constexpr uint32_t testCount = 100;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 64>;
+  MapType map;
+
+  {
+    libzrvan::ds::ExpMapInsertBuffer<MapType, 64, 100000> buffer(map);
+
+    // staged items are only visible through the buffer
+    for (uint64_t i = 0; i < 10; i++) {
+      EXPECT_EQ(buffer.add(i, i, 10), true);
+    }
+    EXPECT_EQ(buffer.size(), 10);
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.findR(5), false);
+    EXPECT_EQ(
+        buffer.findR(5, [](uint64_t &val) -> bool { return val == 5; }),
+        true);
+
+    // flush
+    EXPECT_EQ(buffer.flush(), 10);
+    EXPECT_EQ(buffer.size(), 0);
+    EXPECT_EQ(map.size(), 10);
+    EXPECT_EQ(map.findR(5), true);
+    EXPECT_EQ(buffer.findR(5), true);
+
+    // flush on full buffer
+    for (uint64_t i = 10; i < testCount; i++) {
+      buffer.add(i, i, 10);
+    }
+    EXPECT_EQ(map.size() + buffer.size(), testCount);
+    EXPECT_EQ(buffer.size(), (testCount - 10) % 64);
+  }
+
+  // flush on destroy
+  EXPECT_EQ(map.size(), testCount);
+  EXPECT_EQ(map.forEach(nullptr), testCount);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(
+        map.findR(i, [&](uint64_t &val) -> bool { return val == i; }), true);
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, exp_map_insert_buffer_test_threads) {
+  static constexpr uint32_t testCount = 10000;
+  static constexpr uint32_t threadCount = 4;
+  using MapType =
+      libzrvan::ds::ExpMap<uint64_t, uint64_t,
+                           libzrvan::utils::FastHash<uint64_t>, 1024>;
+  MapType map;
+  std::vector<std::thread> threads;
+
+  for (uint32_t t = 0; t < threadCount; t++) {
+    threads.emplace_back([&map, t]() {
+      libzrvan::ds::ExpMapInsertBuffer<MapType> buffer(map);
+      for (uint64_t i = 0; i < testCount; i++) {
+        buffer.add(t * testCount + i, i, 10);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(map.size(), testCount * threadCount);
+  EXPECT_EQ(map.forEach(nullptr), testCount * threadCount);
+}
+//---------------------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+#pragma once
+#include "../../../include/ds/ExpSet.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, exp_set_test) {
+  static constexpr uint32_t testCount = 10000;
+  libzrvan::ds::ExpSet<uint64_t, libzrvan::utils::FastHash<uint64_t>, 64> set;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(set.insertIfAbsent(i, (i % 2) ? 100 : 1), true);
+  }
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(set.insertIfAbsent(i, 10), false);
+  }
+  EXPECT_EQ(set.size(), testCount);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(set.contains(i), true);
+  }
+  EXPECT_EQ(set.contains(testCount), false);
+
+  EXPECT_EQ(set.remove(0), true);
+  EXPECT_EQ(set.remove(0), false);
+  EXPECT_EQ(set.contains(0), false);
+  EXPECT_EQ(set.size(), testCount - 1);
+
+  // expire the keys with the short TTL
+  uint32_t cTime = libzrvan::utils::Time::getTime() + 10;
+  size_t removed = 0;
+  for (uint32_t i = 0; i < 64; i++) {
+    removed += set.expireCheck(cTime);
+  }
+  EXPECT_EQ(removed, testCount / 2 - 1);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(set.contains(i), (i % 2) == 1);
+  }
+
+  set.flush();
+  EXPECT_EQ(set.size(), 0);
+}
+//---------------------------------------------------------------------------------------
+// the set entries only keep the key and the TTL informations
+TEST(ds, exp_set_layout_test) {
+  static constexpr uint32_t testCount = 6400;
+  libzrvan::ds::ExpSet<uint64_t, libzrvan::utils::FastHash<uint64_t>, 1> set;
+  libzrvan::ds::ExpMap<uint64_t, uint64_t, libzrvan::utils::FastHash<uint64_t>,
+                       1>
+      map;
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    set.insertIfAbsent(i, 10);
+    map.add(i, i, 10);
+  }
+  auto setStats = set.stats();
+  auto mapStats = map.stats();
+  EXPECT_EQ(setStats.slots, mapStats.slots);
+  size_t setSlot = setStats.bytes / setStats.slots;
+  size_t mapSlot = mapStats.bytes / mapStats.slots;
+  // 8 bytes of value and 0 bytes of padding per entry
+  EXPECT_LE(setSlot + 64 * 8, mapSlot + 1);
+  EXPECT_LE(setSlot, 64 * 16 + 64);
+}
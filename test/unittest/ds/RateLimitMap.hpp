@@ -0,0 +1,73 @@
+#pragma once
+#include "../../../include/ds/RateLimitMap.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, rate_limit_map_test) {
+  // 1000 tokens per second, burst of 10
+  libzrvan::ds::RateLimitMap<uint64_t, libzrvan::utils::FastHash<uint64_t>, 64>
+      map(1000, 10);
+  uint64_t now = libzrvan::ds::RateLimitMap<uint64_t>::now();
+
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_EQ(map.consume(1, 1, now), true);
+  }
+  EXPECT_EQ(map.consume(1, 1, now), false);
+  EXPECT_EQ(map.available(1, now), 0);
+  // other keys have their own bucket
+  EXPECT_EQ(map.consume(2, 10, now), true);
+  EXPECT_EQ(map.consume(3, 11, now), false);
+  EXPECT_EQ(map.size(), 3);
+
+  // refill, one token per ms
+  EXPECT_EQ(map.available(1, now + 3000000), 3);
+  EXPECT_EQ(map.consume(1, 3, now + 3000000), true);
+  EXPECT_EQ(map.consume(1, 1, now + 3000000), false);
+  // never more than the burst
+  EXPECT_EQ(map.available(1, now + 1000000000), 10);
+  EXPECT_EQ(map.consume(1, 11, now + 1000000000), false);
+  EXPECT_EQ(map.consume(1, 10, now + 1000000000), true);
+
+  // reset
+  EXPECT_EQ(map.remove(1), true);
+  EXPECT_EQ(map.consume(1, 10, now + 1000000000), true);
+
+  // idle keys expire
+  uint32_t cTime = libzrvan::utils::Time::getTime() + map.getIdleTime() + 2;
+  size_t removed = 0;
+  for (uint32_t i = 0; i < 64; i++) {
+    removed += map.expireCheck(cTime);
+  }
+  EXPECT_EQ(removed, 3);
+  EXPECT_EQ(map.size(), 0);
+}
+//---------------------------------------------------------------------------------------
+// concurrent consumers never take more than the bucket
+TEST(ds, rate_limit_map_concurrency_test) {
+  static constexpr uint32_t threadsCount = 4;
+  static constexpr uint32_t keysCount = 100;
+  static constexpr uint32_t burst = 1000;
+  libzrvan::ds::RateLimitMap<uint64_t, libzrvan::utils::FastHash<uint64_t>, 64>
+      map(1, burst);
+  uint64_t now = libzrvan::ds::RateLimitMap<uint64_t>::now();
+  std::atomic<uint64_t> allowed = {0};
+  std::vector<std::thread> threads;
+
+  for (uint32_t t = 0; t < threadsCount; t++) {
+    threads.emplace_back([&]() {
+      for (uint32_t i = 0; i < burst; i++) {
+        for (uint64_t key = 0; key < keysCount; key++) {
+          if (map.consume(key, 1, now)) {
+            allowed++;
+          }
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(allowed, burst * keysCount);
+}
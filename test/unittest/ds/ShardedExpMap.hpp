@@ -0,0 +1,103 @@
+#pragma once
+#include "../../../include/ds/ShardedExpMap.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, sharded_exp_map_test) {
+  static constexpr uint32_t testCount = 1000;
+  static constexpr uint32_t shardsCount = 4;
+  libzrvan::ds::ShardedExpMap<uint64_t, uint64_t,
+                              libzrvan::utils::FastHash<uint64_t>, 64>
+      map(shardsCount);
+
+  EXPECT_EQ(map.getShardsCount(), shardsCount);
+
+  // every insert is done from shard 0
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.add(0, i, i, 10), true);
+  }
+
+  // remote items are not visible before poll
+  size_t local = map.shard(0).size();
+  EXPECT_EQ(map.size(), local);
+  size_t applied = 0;
+  for (uint32_t s = 1; s < shardsCount; s++) {
+    applied += map.poll(s);
+  }
+  EXPECT_EQ(applied + local, testCount);
+  EXPECT_EQ(map.size(), testCount);
+
+  // each item lives on its owner shard
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.shard(map.shardOf(i)).findR(i), true);
+  }
+
+  // remote execute and remove
+  uint64_t owner = map.shardOf(7);
+  uint32_t from = (owner + 1) % shardsCount;
+  bool found = false;
+  EXPECT_EQ(map.remove(from, 7), true);
+  EXPECT_EQ(map.execute(from, owner,
+                        [&](auto &shard) { found = shard.findR(7); }),
+            true);
+  EXPECT_EQ(map.poll(owner), 2);
+  EXPECT_EQ(found, false);
+  EXPECT_EQ(map.size(), testCount - 1);
+}
+//---------------------------------------------------------------------------------------
+TEST(ds, sharded_exp_map_test_threads) {
+  static constexpr uint32_t testCount = 10000;
+  static constexpr uint32_t shardsCount = 4;
+  libzrvan::ds::ShardedExpMap<uint64_t, uint64_t,
+                              libzrvan::utils::FastHash<uint64_t>, 1024>
+      map(shardsCount);
+  std::atomic<uint32_t> done = {0};
+  std::vector<std::thread> threads;
+
+  for (uint32_t s = 0; s < shardsCount; s++) {
+    threads.emplace_back([&, s]() {
+      for (uint64_t i = 0; i < testCount; i++) {
+        while (!map.add(s, s * testCount + i, i, 10)) {
+          map.poll(s);
+        }
+      }
+      done++;
+      while (done != shardsCount) {
+        map.poll(s);
+      }
+      map.poll(s);
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(map.size(), testCount * shardsCount);
+}
+//---------------------------------------------------------------------------------------
+// thread-confined shards, small mailboxes
+TEST(ds, sharded_exp_map_test_mailbox_size) {
+  static constexpr uint32_t shardsCount = 16;
+  libzrvan::ds::ShardedExpMap<uint64_t, uint64_t,
+                              libzrvan::utils::FastHash<uint64_t>, 64>
+      map(shardsCount, 60);
+  libzrvan::ds::ShardedExpMap<uint64_t, uint64_t,
+                              libzrvan::utils::FastHash<uint64_t>, 64>
+      big(shardsCount);
+  EXPECT_EQ(map.getMailboxBytes() * 16, big.getMailboxBytes());
+
+  // the mailbox of the owner is full after 64 messages
+  uint64_t key = 0;
+  uint32_t owner = map.shardOf(key);
+  uint32_t from = (owner + 1) % shardsCount;
+  uint32_t posted = 0;
+  while (map.upsert(from, key, key, 10)) {
+    posted++;
+  }
+  EXPECT_EQ(posted, 64);
+  EXPECT_EQ(map.poll(owner), 64);
+  EXPECT_EQ(map.shard(owner).size(), 1);
+}
+//---------------------------------------------------------------------------------------
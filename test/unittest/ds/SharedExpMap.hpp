@@ -0,0 +1,173 @@
+#pragma once
+#include "../../../include/ds/SharedExpMap.hpp"
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------------------
+// functionality test
+TEST(ds, shared_exp_map_test) {
+  static constexpr uint32_t testCount = 10000;
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 64>
+      map;
+
+  EXPECT_EQ(map.open("", 1024), true);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.add(i, i, 10), true);
+  }
+  EXPECT_EQ(map.size(), testCount);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    uint64_t value = 0;
+    EXPECT_EQ(map.findR(i,
+                        [&](uint64_t &v) {
+                          value = v;
+                          return true;
+                        }),
+              true);
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_EQ(map.findR(testCount), false);
+
+  // write access
+  EXPECT_EQ(map.findW(5,
+                      [](uint64_t &v) {
+                        v = 500;
+                        return true;
+                      }),
+            true);
+  EXPECT_EQ(map.findR(5, [](uint64_t &v) { return v == 500; }), true);
+
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.remove(i), true);
+  }
+  EXPECT_EQ(map.size(), 0);
+
+  // capacity limit, every slot is released again
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 1>
+      small;
+  EXPECT_EQ(small.open("", 1), true);
+  for (uint64_t i = 0; i < 64; i++) {
+    EXPECT_EQ(small.add(i, i, 0), true);
+  }
+  EXPECT_EQ(small.add(64, 64, 0), false);
+  EXPECT_EQ(small.expireCheck(libzrvan::utils::Time::getTime() + 1), 64);
+  EXPECT_EQ(small.add(64, 64, 0), true);
+}
+//---------------------------------------------------------------------------------------
+// multi process test
+TEST(ds, shared_exp_map_test_processes) {
+  static constexpr uint32_t testCount = 10000;
+  static constexpr uint32_t processCount = 4;
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 1024>
+      map;
+
+  EXPECT_EQ(map.open("", 4096), true);
+
+  for (uint32_t p = 0; p < processCount; p++) {
+    if (fork() == 0) {
+      bool ok = true;
+      for (uint64_t i = p; i < testCount; i += processCount) {
+        ok &= map.add(i, i * 2, 10);
+      }
+      _exit(ok ? 0 : 1);
+    }
+  }
+  for (uint32_t p = 0; p < processCount; p++) {
+    int status = 0;
+    wait(&status);
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+  }
+
+  EXPECT_EQ(map.size(), testCount);
+  for (uint64_t i = 0; i < testCount; i++) {
+    EXPECT_EQ(map.findR(i, [&](uint64_t &v) { return v == i * 2; }), true);
+  }
+}
+//---------------------------------------------------------------------------------------
+// a process dies while holding a segment lock
+TEST(ds, shared_exp_map_test_owner_dead) {
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 1>
+      map;
+
+  EXPECT_EQ(map.open("", 16), true);
+  EXPECT_EQ(map.add(1, 1, 10), true);
+
+  if (fork() == 0) {
+    map.findW(1, [](uint64_t &) -> bool { _exit(0); });
+    _exit(1);
+  }
+  int status = 0;
+  wait(&status);
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  // the lock is recovered
+  EXPECT_EQ(map.add(2, 2, 10), true);
+  EXPECT_EQ(map.findR(1), true);
+  EXPECT_EQ(map.findR(2), true);
+  EXPECT_EQ(map.remove(1), true);
+  EXPECT_EQ(map.size(), 1);
+}
+//---------------------------------------------------------------------------------------
+// named shared memory object
+TEST(ds, shared_exp_map_test_named) {
+  const std::string name = "/libzrvan-test-" + std::to_string(getpid());
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 64>
+      writer;
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 64>
+      reader;
+
+  EXPECT_EQ(writer.open(name, 64), true);
+  EXPECT_EQ(reader.open(name, 0), true);
+  EXPECT_EQ(reader.getSlotsCount(), 64);
+  EXPECT_EQ(writer.add(10, 100, 10), true);
+  EXPECT_EQ(reader.findR(10, [](uint64_t &v) { return v == 100; }), true);
+  EXPECT_EQ(writer.unlink(name), true);
+}
+//---------------------------------------------------------------------------------------
+// the creator never sized the region
+TEST(ds, shared_exp_map_test_attach_timeout) {
+  const std::string name = "/libzrvan-test-empty-" + std::to_string(getpid());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  ASSERT_GE(fd, 0);
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 64>
+      reader;
+  EXPECT_EQ(reader.open(name, 0), false);
+  ::close(fd);
+  shm_unlink(name.c_str());
+}
+//---------------------------------------------------------------------------------------
+// a hit extends the life while another thread holds the segment lock
+TEST(ds, shared_exp_map_test_extend_contended) {
+  libzrvan::ds::SharedExpMap<uint64_t, uint64_t,
+                             libzrvan::utils::FastHash<uint64_t>, 1>
+      map;
+
+  EXPECT_EQ(map.open("", 16), true);
+  uint32_t start = libzrvan::utils::Time::getTime();
+  EXPECT_EQ(map.add(1, 1, 0), true);
+
+  // removing a missing key takes the lock without a write section, so the
+  // optimistic reads still succeed
+  std::atomic<bool> done{false};
+  std::thread contender([&]() {
+    while (!done.load()) {
+      map.remove(2);
+    }
+  });
+  while (libzrvan::utils::Time::getTime() == start) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(map.findR(1), true);
+  done = true;
+  contender.join();
+
+  EXPECT_EQ(map.expireCheck(libzrvan::utils::Time::getTime()), 0);
+  EXPECT_EQ(map.findR(1), true);
+}
@@ -2,11 +2,21 @@
 #include "utils/DeferTest.hpp"
 #include "ds/ExpSlotList.hpp"
 #include "ds/ExpMap.hpp"
+#include "ds/ExpFlatMap.hpp"
+#include "ds/ExpSet.hpp"
+#include "ds/ExpMapInsertBuffer.hpp"
+#include "ds/RateLimitMap.hpp"
+#include "ds/ShardedExpMap.hpp"
+#include "ds/SharedExpMap.hpp"
 #include "utils/CounterTest.hpp"
 #include "utils/CoreHash.hpp"
 #include "utils/FastHash.hpp"
+#include "utils/HugePage.hpp"
 #include "utils/Lock.hpp"
+#include "utils/Numa.hpp"
+#include "utils/SPSCQueue.hpp"
 #include "utils/StaticLoop.hpp"
+#include "utils/ThreadPool.hpp"
 #include "utils/Time.hpp"
 
 //---------------------------------------------------------------------------------------
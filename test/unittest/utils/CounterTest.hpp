@@ -1,5 +1,6 @@
 #pragma once
 #include "../../../include/utils/Counter.hpp"
+#include "../../../include/utils/StripedCounter.hpp"
 #include "../../../include/utils/StaticLoop.hpp"
 #include <gtest/gtest.h>
 #include <string>
@@ -82,3 +83,31 @@ TEST(utils, attomic_counter_test) {
 
   EXPECT_EQ(0, cnt);
 }
+//---------------------------------------------------------------------------------------
+TEST(utils, striped_counter_test) {
+  libzrvan::utils::StripedCounter<> cnt;
+
+  // add thread
+  auto addThread = [&]() {
+    for (uint64_t i = 0; i < countersLoopCount_; i++) {
+      cnt.add(1);
+    }
+  };
+
+  // remove thread
+  auto removeThread = [&]() {
+    for (uint64_t i = 0; i < countersLoopCount_; i++) {
+      cnt.sub(1);
+    }
+  };
+
+  for (auto &i : countersThreadCount_) {
+    runCounterTest(i, addThread, removeThread);
+  }
+
+  EXPECT_EQ(0, cnt.get());
+  cnt += 10;
+  EXPECT_EQ(10, cnt.get());
+  cnt.reset();
+  EXPECT_EQ(0, cnt.get());
+}
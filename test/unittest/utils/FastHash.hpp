@@ -66,3 +66,104 @@ TEST(utils, hash_stdhash_test_performance) {
   testAllStrings<std::hash<std::string>>();
 }
 //---------------------------------------------------------------------------------------
+// flow key, 40 bytes without padding
+struct FastHashFlowKey {
+  uint64_t src[2];
+  uint64_t dst[2];
+  uint16_t srcPort;
+  uint16_t dstPort;
+  uint32_t proto;
+};
+//---------------------------------------------------------------------------------------
+TEST(utils, hash_fasthash_pod_test) {
+  uint8_t buffer[40];
+  for (uint32_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = i * 7 + 1;
+  }
+  // the unrolled kernels return the same result as hash64
+  using Core = libzrvan::utils::FastHashCore;
+  EXPECT_EQ(Core::hash64Fixed<8>(buffer), Core::hash64(buffer, 8));
+  EXPECT_EQ(Core::hash64Fixed<16>(buffer), Core::hash64(buffer, 16));
+  EXPECT_EQ(Core::hash64Fixed<32>(buffer), Core::hash64(buffer, 32));
+  EXPECT_EQ(Core::hash64Fixed<40>(buffer), Core::hash64(buffer, 40));
+
+  libzrvan::utils::FastHash<FastHashFlowKey> flowHash;
+  FastHashFlowKey key = {{1, 2}, {3, 4}, 80, 1024, 6};
+  FastHashFlowKey other = key;
+  EXPECT_EQ(flowHash(key), flowHash(other));
+  EXPECT_EQ(flowHash(key),
+            Core::hash64(reinterpret_cast<const uint8_t *>(&key), sizeof(key)));
+  other.srcPort++;
+  EXPECT_NE(flowHash(key), flowHash(other));
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, hash_fasthash_integral_test) {
+  static constexpr uint32_t testCount = 64 * 1024;
+  static constexpr uint32_t segments = 64;
+  libzrvan::utils::FastHash<uint64_t> hash;
+  libzrvan::utils::FastHash<uint32_t> hash32;
+  uint32_t buckets[segments] = {0};
+
+  // sequential and strided keys are spread over the segments
+  for (uint64_t i = 0; i < testCount; i++) {
+    buckets[hash(i * segments) % segments]++;
+    EXPECT_EQ(hash32(uint32_t(i)), hash(i));
+  }
+  for (auto b : buckets) {
+    EXPECT_GT(b, testCount / segments / 2);
+    EXPECT_LT(b, testCount / segments * 2);
+  }
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, hash_fasthash_wide_test) {
+  using Core = libzrvan::utils::FastHashCore;
+  std::vector<uint8_t> buffer(4096);
+  for (uint32_t i = 0; i < buffer.size(); i++) {
+    buffer[i] = (i * 131) ^ (i >> 8);
+  }
+
+  // the short inputs use hash64
+  for (size_t len = 0; len < Core::wideMinLen; len++) {
+    EXPECT_EQ(Core::hash64Wide(buffer.data(), len),
+              Core::hash64(buffer.data(), len));
+  }
+
+  // each length, each byte and the position of the bytes change the hash
+  std::unordered_set<uint64_t> hashes;
+  for (size_t len = Core::wideMinLen; len < 512; len++) {
+    hashes.insert(Core::hash64Wide(buffer.data(), len));
+  }
+  EXPECT_EQ(hashes.size(), 512 - Core::wideMinLen);
+  hashes.clear();
+  for (size_t i = 0; i < 300; i++) {
+    std::vector<uint8_t> in(buffer.begin(), buffer.begin() + 300);
+    in[i] ^= 1;
+    hashes.insert(Core::hash64Wide(in.data(), in.size()));
+  }
+  EXPECT_EQ(hashes.size(), 300);
+  std::vector<uint8_t> swapped(buffer.begin(), buffer.begin() + 256);
+  std::swap_ranges(swapped.begin(), swapped.begin() + 8, swapped.begin() + 8);
+  EXPECT_NE(Core::hash64Wide(swapped.data(), swapped.size()),
+            Core::hash64Wide(buffer.data(), swapped.size()));
+
+  libzrvan::utils::FastHashWide<std::string> wideHash;
+  std::string url(1024, 'u');
+  EXPECT_EQ(wideHash(url), Core::hash64Wide(
+                               reinterpret_cast<const uint8_t *>(url.data()),
+                               url.size()));
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, hash_fasthash_wide_test_performance64) {
+  std::cout << "hash64" << std::endl;
+  testAllStrings<libzrvan::utils::FastHash<std::string>>();
+  for (size_t len : {1024, 4096}) {
+    testWithHash<libzrvan::utils::FastHash<std::string>>(std::string(len, 'a'));
+  }
+  std::cout << "hash64Wide" << std::endl;
+  testAllStrings<libzrvan::utils::FastHashWide<std::string>>();
+  for (size_t len : {1024, 4096}) {
+    testWithHash<libzrvan::utils::FastHashWide<std::string>>(
+        std::string(len, 'a'));
+  }
+}
+//---------------------------------------------------------------------------------------
@@ -0,0 +1,45 @@
+#pragma once
+#include "../../../include/utils/HugePage.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------------------
+TEST(utils, huge_page_test_functionality) {
+  size_t len = libzrvan::utils::HugePage::roundUp(3 * 1024 * 1024, true);
+  EXPECT_EQ(len, 4 * 1024 * 1024);
+
+  void *mem = libzrvan::utils::HugePage::map(len, true);
+  ASSERT_NE(mem, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mem) %
+                libzrvan::utils::HugePage::hugePageSize_,
+            0);
+  memset(mem, 1, len);
+  size_t huge = libzrvan::utils::HugePage::hugeBytes(mem, len);
+  libzrvan::utils::HugePage::unmap(mem, len);
+  EXPECT_LE(huge, len);
+  if (!libzrvan::utils::HugePage::available()) {
+    GTEST_SKIP() << "huge pages are not available";
+  }
+  EXPECT_GT(huge, 0);
+}
+//---------------------------------------------------------------------------------------
+// the mapping is merged with a neighbor VMA
+TEST(utils, huge_page_test_merged) {
+  size_t len = 4 * libzrvan::utils::HugePage::hugePageSize_;
+  void *mem = libzrvan::utils::HugePage::map(len, true);
+  ASSERT_NE(mem, nullptr);
+  memset(mem, 1, len);
+  uint8_t *half = static_cast<uint8_t *>(mem) + len / 2;
+  size_t total = libzrvan::utils::HugePage::hugeBytes(mem, len);
+  size_t first = libzrvan::utils::HugePage::hugeBytes(mem, len / 2);
+  size_t second = libzrvan::utils::HugePage::hugeBytes(half, len / 2);
+  libzrvan::utils::HugePage::unmap(mem, len);
+  EXPECT_LE(first, len / 2);
+  EXPECT_LE(second, len / 2);
+  EXPECT_LE(first + second, total + 2);
+  if (!libzrvan::utils::HugePage::available()) {
+    GTEST_SKIP() << "huge pages are not available";
+  }
+  EXPECT_GT(first, 0);
+  EXPECT_GT(second, 0);
+}
+//---------------------------------------------------------------------------------------
@@ -0,0 +1,21 @@
+#pragma once
+#include "../../../include/utils/Numa.hpp"
+#include <cstring>
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------------------
+TEST(utils, numa_test_functionality) {
+  uint32_t nodes = libzrvan::utils::Numa::nodesCount();
+  EXPECT_GE(nodes, 1);
+  EXPECT_LT(libzrvan::utils::Numa::currentNode(), nodes);
+
+  // allocate from each node
+  for (uint32_t i = 0; i < nodes; i++) {
+    libzrvan::utils::NumaMemoryResource resource(i);
+    EXPECT_EQ(resource.node(), i);
+    void *mem = resource.allocate(10000);
+    EXPECT_NE(mem, nullptr);
+    memset(mem, 1, 10000);
+    resource.deallocate(mem, 10000);
+  }
+}
+//---------------------------------------------------------------------------------------
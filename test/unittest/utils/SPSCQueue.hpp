@@ -0,0 +1,66 @@
+#pragma once
+#include "../../../include/utils/SPSCQueue.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+//---------------------------------------------------------------------------------------
+TEST(utils, spsc_queue_test_functionality) {
+  libzrvan::utils::SPSCQueue<uint64_t, 8> queue;
+  uint64_t val;
+
+  EXPECT_EQ(queue.pop(val), false);
+  for (uint64_t i = 0; i < queue.capacity(); i++) {
+    EXPECT_EQ(queue.push(i), true);
+  }
+  EXPECT_EQ(queue.push(100), false);
+  EXPECT_EQ(queue.size(), 8);
+
+  for (uint64_t i = 0; i < queue.capacity(); i++) {
+    EXPECT_EQ(queue.pop(val), true);
+    EXPECT_EQ(val, i);
+  }
+  EXPECT_EQ(queue.pop(val), false);
+  EXPECT_EQ(queue.empty(), true);
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, spsc_queue_test_threads) {
+  static const uint64_t loopCount = 1000000;
+  libzrvan::utils::SPSCQueue<uint64_t, 1024> queue;
+  uint64_t sum = 0;
+
+  std::thread producer([&]() {
+    for (uint64_t i = 1; i <= loopCount; i++) {
+      while (!queue.push(i)) {
+      }
+    }
+  });
+
+  uint64_t expected = 1;
+  while (expected <= loopCount) {
+    uint64_t val;
+    if (queue.pop(val)) {
+      EXPECT_EQ(val, expected);
+      sum += val;
+      expected++;
+    }
+  }
+  producer.join();
+  EXPECT_EQ(sum, loopCount * (loopCount + 1) / 2);
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, spsc_queue_test_runtime_size) {
+  libzrvan::utils::SPSCQueue<uint64_t, 0> queue(5);
+  uint64_t val;
+
+  EXPECT_EQ(queue.capacity(), 8);
+  for (uint64_t i = 0; i < 3 * queue.capacity(); i++) {
+    EXPECT_EQ(queue.push(i), true);
+    EXPECT_EQ(queue.pop(val), true);
+    EXPECT_EQ(val, i);
+  }
+  for (uint64_t i = 0; i < queue.capacity(); i++) {
+    EXPECT_EQ(queue.push(i), true);
+  }
+  EXPECT_EQ(queue.push(100), false);
+  EXPECT_EQ(queue.size(), 8);
+}
+//---------------------------------------------------------------------------------------
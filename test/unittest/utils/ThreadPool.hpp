@@ -0,0 +1,50 @@
+#pragma once
+#include "../../../include/utils/ThreadPool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+//---------------------------------------------------------------------------------------
+TEST(utils, thread_pool_test_functionality) {
+  static constexpr uint32_t taskCount = 1000;
+  std::atomic<uint32_t> done = {0};
+  {
+    libzrvan::utils::ThreadPool pool(4);
+    EXPECT_EQ(pool.getThreadsCount(), 4);
+    for (uint32_t i = 0; i < taskCount; i++) {
+      pool.submit([&]() { done++; });
+    }
+  }
+  // the destructor runs the remaining tasks
+  EXPECT_EQ(done, taskCount);
+}
+//---------------------------------------------------------------------------------------
+TEST(utils, thread_pool_test_parallel_for) {
+  static constexpr size_t count = 100000;
+  libzrvan::utils::ThreadPool pool(4);
+  std::vector<uint8_t> visited(count, 0);
+
+  pool.parallelFor(count, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      visited[i]++;
+    }
+  });
+  for (auto v : visited) {
+    EXPECT_EQ(v, 1);
+  }
+
+  // limited parallelism and nested calls
+  std::atomic<size_t> total = {0};
+  pool.parallelFor(
+      16,
+      [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+          pool.parallelFor(100, [&](size_t f, size_t l) { total += l - f; });
+        }
+      },
+      2, 1);
+  EXPECT_EQ(total, 1600);
+
+  // empty range
+  pool.parallelFor(0, [&](size_t, size_t) { total++; });
+  EXPECT_EQ(total, 1600);
+}